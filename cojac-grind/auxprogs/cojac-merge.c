@@ -0,0 +1,242 @@
+/*--------------------------------------------------------------------*/
+/*--- Merges the compact site reports of Cojac.                    ---*/
+/*---                                                cojac-merge.c ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+*/
+
+/* Usage: cojac-merge [-o <output>] <report-file>...
+ *
+ * Reads the files written with "valgrind --tool=cojac --report-file=...",
+ * typically one per MPI rank, and prints one deduplicated report where
+ * every site appears once, with its total count and the count of each
+ * rank that hit it.
+ *
+ * The files are read in one streaming pass: each line is looked up in a
+ * hash table keyed by the site (kind, op, function, file:line; plus the
+ * address for sites without debug info, as addresses differ between
+ * processes), so the merge is linear in the size of the logs. Only the
+ * final list of distinct sites is sorted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LINE   4096
+#define MAX_SHOWN  16     // ranks listed per site
+
+typedef struct {
+   int                proc;    // index in procs[]
+   unsigned long long count;
+} RankCount;
+
+typedef struct {
+   char*              key;     // "kind\top\tfn\tfile:line[\taddr]"
+   unsigned long long total;
+   RankCount*         ranks;
+   int                nRanks, capRanks;
+} Site;
+
+static Site*  table    = NULL;  // open addressing, NULL key = free
+static size_t tableCap = 0;
+static size_t nSites   = 0;
+
+static char** procs    = NULL;  // rank (or pid) of each input file
+static int    nProcs   = 0;
+
+/*---------------------------------------------------------------*/
+static void* xmalloc(size_t n) {
+   void* p = malloc(n);
+   if (p == NULL) { fprintf(stderr, "cojac-merge: out of memory\n"); exit(1); }
+   return p;
+}
+
+static void* xrealloc(void* p, size_t n) {
+   p = realloc(p, n);
+   if (p == NULL) { fprintf(stderr, "cojac-merge: out of memory\n"); exit(1); }
+   return p;
+}
+
+static char* xstrdup(const char* s) {
+   char* d = xmalloc(strlen(s) + 1);
+   strcpy(d, s);
+   return d;
+}
+
+static unsigned long hash(const char* s) {
+   unsigned long h = 2166136261UL;   // FNV-1a
+   while (*s) { h ^= (unsigned char)*s++; h *= 16777619UL; }
+   return h;
+}
+
+static void grow(void) {
+   Site*  old    = table;
+   size_t oldCap = tableCap, i;
+   tableCap = oldCap ? 2 * oldCap : 1024;
+   table = calloc(tableCap, sizeof(Site));
+   if (table == NULL) { fprintf(stderr, "cojac-merge: out of memory\n"); exit(1); }
+   for (i = 0; i < oldCap; i++) {
+      size_t j;
+      if (old[i].key == NULL) continue;
+      j = hash(old[i].key) & (tableCap - 1);
+      while (table[j].key != NULL) j = (j + 1) & (tableCap - 1);
+      table[j] = old[i];
+   }
+   free(old);
+}
+
+static Site* lookup(const char* key) {
+   size_t j;
+   if (2 * (nSites + 1) > tableCap) grow();
+   j = hash(key) & (tableCap - 1);
+   while (table[j].key != NULL) {
+      if (strcmp(table[j].key, key) == 0) return &table[j];
+      j = (j + 1) & (tableCap - 1);
+   }
+   table[j].key = xstrdup(key);
+   nSites++;
+   return &table[j];
+}
+
+/*---------------------------------------------------------------*/
+static void add_count(Site* s, int proc, unsigned long long count) {
+   s->total += count;
+   // several addresses of one file may map to the same site (eg. two
+   // instructions of a line): then the rank is the last entry
+   if (s->nRanks > 0 && s->ranks[s->nRanks - 1].proc == proc) {
+      s->ranks[s->nRanks - 1].count += count;
+      return;
+   }
+   if (s->nRanks == s->capRanks) {
+      s->capRanks = s->capRanks ? 2 * s->capRanks : 4;
+      s->ranks = xrealloc(s->ranks, s->capRanks * sizeof(RankCount));
+   }
+   s->ranks[s->nRanks].proc  = proc;
+   s->ranks[s->nRanks].count = count;
+   s->nRanks++;
+}
+
+/* Splits a line in at most n tab-separated fields, in place */
+static int split(char* line, char** f, int n) {
+   int k = 0;
+   char* p = line;
+   while (k < n) {
+      f[k++] = p;
+      p = strchr(p, '\t');
+      if (p == NULL) break;
+      *p++ = '\0';
+   }
+   return k;
+}
+
+static void read_report(const char* name) {
+   char  line[MAX_LINE], key[MAX_LINE];
+   char* f[6];
+   int   proc = nProcs;
+   FILE* in = fopen(name, "r");
+   if (in == NULL) {
+      fprintf(stderr, "cojac-merge: cannot open '%s'\n", name);
+      exit(1);
+   }
+   procs = xrealloc(procs, (nProcs + 1) * sizeof(char*));
+   procs[nProcs++] = xstrdup(name);
+   while (fgets(line, sizeof(line), in) != NULL) {
+      line[strcspn(line, "\n")] = '\0';
+      if (line[0] == '#') {
+         int  pid;
+         char rank[64];
+         if (sscanf(line, "# pid %d rank %63s", &pid, rank) == 2) {
+            free(procs[proc]);
+            if (strcmp(rank, "-") == 0) snprintf(rank, sizeof(rank), "pid%d", pid);
+            procs[proc] = xstrdup(rank);
+         }
+         continue;
+      }
+      f[5] = NULL;
+      if (split(line, f, 6) < 5) continue;   // not a site line
+      if (strcmp(f[3], "???") == 0 && f[5] != NULL)
+         snprintf(key, sizeof(key), "%s\t%s\t%s\t%s\t%s", f[0], f[2], f[3], f[4], f[5]);
+      else
+         snprintf(key, sizeof(key), "%s\t%s\t%s\t%s", f[0], f[2], f[3], f[4]);
+      add_count(lookup(key), proc, strtoull(f[1], NULL, 10));
+   }
+   fclose(in);
+}
+
+/*---------------------------------------------------------------*/
+static int by_total(const void* a, const void* b) {
+   const Site* x = *(const Site* const*)a;
+   const Site* y = *(const Site* const*)b;
+   if (x->total != y->total) return x->total < y->total ? 1 : -1;
+   return strcmp(x->key, y->key);
+}
+
+static void print_report(FILE* out) {
+   Site** sorted = xmalloc((nSites + 1) * sizeof(Site*));
+   size_t i, n = 0;
+   for (i = 0; i < tableCap; i++)
+      if (table[i].key != NULL) sorted[n++] = &table[i];
+   qsort(sorted, n, sizeof(Site*), by_total);
+   fprintf(out, "Cojac merged report: %zu sites, %d processes\n", n, nProcs);
+   for (i = 0; i < n; i++) {
+      Site* s = sorted[i];
+      char* f[5];
+      int   k, nf = split(s->key, f, 5);
+      fprintf(out, "%-12s %12llu  %d/%d ranks  %s  %s (%s)",
+              f[0], s->total, s->nRanks, nProcs, f[1], f[2], f[3]);
+      if (nf == 5) fprintf(out, " %s", f[4]);
+      fprintf(out, "\n    ranks:");
+      for (k = 0; k < s->nRanks && k < MAX_SHOWN; k++)
+         fprintf(out, " %s:%llu", procs[s->ranks[k].proc], s->ranks[k].count);
+      if (s->nRanks > MAX_SHOWN)
+         fprintf(out, " ... (%d more)", s->nRanks - MAX_SHOWN);
+      fprintf(out, "\n");
+   }
+   free(sorted);
+}
+
+int main(int argc, char** argv) {
+   FILE* out = stdout;
+   int   i = 1;
+   if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+      out = fopen(argv[2], "w");
+      if (out == NULL) {
+         fprintf(stderr, "cojac-merge: cannot create '%s'\n", argv[2]);
+         return 1;
+      }
+      i = 3;
+   }
+   if (i >= argc) {
+      fprintf(stderr, "usage: cojac-merge [-o <output>] <report-file>...\n");
+      return 1;
+   }
+   for (; i < argc; i++)
+      read_report(argv[i]);
+   print_report(out);
+   if (out != stdout) fclose(out);
+   return 0;
+}
@@ -0,0 +1,302 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.              oa_batch ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* Batched checking (--batch=yes, amd64 only).
+ *
+ * Instead of one dirty call per watched operation, the operands of every
+ * watched op of a superblock are written with plain IR stores into an
+ * operand buffer, and a single dirty call checks the whole batch when the
+ * block is left (before each side exit and at the end of the block), or
+ * when the buffer is full.
+ *
+ * Each thread has its own buffer, made when it first runs. The stores go
+ * through a pointer to the buffer of the running thread, set when a thread
+ * starts running client code and loaded once per superblock: a thread
+ * switch only happens between superblocks, and the buffer is always
+ * flushed before the superblock is left.
+ *
+ * The flush first runs cheap screening kernels over the whole batch. They
+ * only look at the bits of the operands (and of the recomputed result),
+ * without branches, so that the compiler can vectorise them. Only the ops
+ * that the screen marks as suspicious go through the exact check_* code.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "pub_tool_libcbase.h"
+#include "pub_tool_mallocfree.h"
+#include "pub_tool_threadstate.h"
+#include "pub_tool_machine.h"     // VG_(fnptr_to_fnentry)
+#include "oa_include.h"
+#include "oa_utils.h"
+
+/*--------------------------------------------------------------------*/
+#define OA_EXP_MASK 0x7FF
+
+typedef struct {
+  ULong a;
+  ULong b;
+} OA_BatchSlot;
+
+/* What the screening kernels know about a slot. */
+typedef enum {
+  Screen_None,     // no cheap screen: always checked exactly
+  Screen_AddF64,
+  Screen_SubF64,
+  Screen_MulF64,
+  Screen_DivF64,
+  Screen_CmpF64,
+  Screen_Add32,
+  Screen_Sub32,
+  Screen_Add64,
+  Screen_Sub64
+} OA_Screen;
+
+/* Static description of one batch, built at translation time. */
+struct _OA_BatchDesc {
+  void*                callback[OA_BATCH_MAX];
+  OA_InstrumentContext ic[OA_BATCH_MAX];
+  UChar                nArgs[OA_BATCH_MAX];
+  UChar                screen[OA_BATCH_MAX];
+};
+
+typedef VG_REGPARM(2) void (*oa_callback_1)(ULong a, OA_InstrumentContext ic);
+typedef VG_REGPARM(3) void (*oa_callback_2)(ULong a, ULong b, OA_InstrumentContext ic);
+
+static OA_BatchSlot* bufOf[VG_N_THREADS];  // allocated at first run
+static OA_BatchSlot* curBuf = NULL;
+
+// translation-time state of the batch being filled
+static OA_BatchDesc curDesc = NULL;
+static Int          curUsed = 0;
+static IRTemp       curBase = IRTemp_INVALID;  // curBuf, loaded in this SB
+
+// smallest exponent gap between operand and result that may hide a
+// cancellation (derived from the ulp factor in OA_(batch_init))
+static Int cancelExpGap;
+
+/*--------------------------------------------------------------------*/
+static OA_Screen screenFromIROp(IROp op) {
+  switch(op) {
+    case Iop_Add64F0x2: case Iop_Add64Fx2: return Screen_AddF64;
+    case Iop_Sub64F0x2: case Iop_Sub64Fx2: return Screen_SubF64;
+    case Iop_Mul64F0x2: case Iop_Mul64Fx2: return Screen_MulF64;
+    case Iop_Div64F0x2: case Iop_Div64Fx2: return Screen_DivF64;
+    case Iop_CmpF64:                       return Screen_CmpF64;
+    case Iop_Add32:                        return Screen_Add32;
+    case Iop_Sub32:                        return Screen_Sub32;
+    case Iop_Add64:                        return Screen_Add64;
+    case Iop_Sub64:                        return Screen_Sub64;
+    default:                               return Screen_None;
+  }
+}
+
+void OA_(batch_init)(void) {
+  // |a-b| <= k*ulp(a) implies exp(a-b) <= exp(a) - 52 + log2(k)
+  Int log2k=0;
+  Double k=OA_(options).Ulp_factor_f64;
+  while (k > 1.0) { k/=2.0; log2k++; }
+  cancelExpGap = 52 - log2k - 1;  // one more for the rounding of the result
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Screening kernels                                            ---*/
+/*--------------------------------------------------------------------*/
+
+static inline ULong bitsF64(Double d) {
+  oa_mix64_t m;
+  m.f=d;
+  return m.u;
+}
+
+static inline Double f64Bits(ULong l) {
+  oa_mix64_t m;
+  m.u=l;
+  return m.f;
+}
+
+static inline Int expF64(ULong bits) {
+  return (Int)((bits >> 52) & OA_EXP_MASK);
+}
+
+// True for zero, subnormal, infinite and NaN
+static inline UInt isEdgeExp(Int e) {
+  return (e == 0) | (e == OA_EXP_MASK);
+}
+
+/* Marks in need[] the slots that may raise a Cojac error. It must never
+ * miss one, but may (rarely) mark a harmless op. Every lane computes all
+ * the candidate results and the right one is selected by mask, so the
+ * loop body has no data-dependent branch. */
+static void screen_batch(const OA_BatchSlot* s, const UChar* screen,
+                         UChar* need, Int n) {
+  Int i;
+  for (i=0; i<n; i++) {
+    UInt c = screen[i];
+    ULong ua = s[i].a, ub = s[i].b;
+    Double a = f64Bits(ua), b = f64Bits(ub);
+    ULong rAdd = bitsF64(a+b);
+    ULong rSub = bitsF64(a-b);
+    ULong rMul = bitsF64(a*b);
+    ULong rDiv = bitsF64(a/b);
+    ULong mAdd = -(ULong)(c == Screen_AddF64);
+    ULong mSub = -(ULong)(c == Screen_SubF64 || c == Screen_CmpF64);
+    ULong mMul = -(ULong)(c == Screen_MulF64);
+    ULong mDiv = -(ULong)(c == Screen_DivF64);
+    ULong r = (rAdd & mAdd) | (rSub & mSub) | (rMul & mMul) | (rDiv & mDiv);
+    Int ea = expF64(ua), eb = expF64(ub), er = expF64(r);
+    Int gap = ea - eb;
+    UInt fpLinear = (c == Screen_AddF64) | (c == Screen_SubF64)
+                  | (c == Screen_CmpF64);
+    UInt fp = fpLinear | (c == Screen_MulF64) | (c == Screen_DivF64);
+    UInt fpHit = isEdgeExp(ea) | isEdgeExp(eb) | isEdgeExp(er)
+               | (fpLinear & ((ea - er >= cancelExpGap) | (eb - er >= cancelExpGap)
+                              | (gap >= 52) | (gap <= -52)));
+
+    UInt  a32 = (UInt)ua,  b32 = (UInt)ub;
+    UInt  s32 = (c == Screen_Add32) ? a32+b32 : a32-b32;
+    UInt  o32 = (c == Screen_Add32) ? ((a32^s32) & (b32^s32))
+                                    : ((a32^b32) & (a32^s32));
+    ULong s64 = (c == Screen_Add64) ? ua+ub : ua-ub;
+    ULong o64 = (c == Screen_Add64) ? ((ua^s64) & (ub^s64))
+                                    : ((ua^ub) & (ua^s64));
+    UInt i32 = (c == Screen_Add32) | (c == Screen_Sub32);
+    UInt i64 = (c == Screen_Add64) | (c == Screen_Sub64);
+    UInt intHit = (i32 & (o32 >> 31)) | (i64 & (UInt)(o64 >> 63));
+
+    need[i] = (c == Screen_None) | (fp & fpHit) | intHit;
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Runtime: called from the instrumented code                   ---*/
+/*--------------------------------------------------------------------*/
+
+void OA_(batch_thread_switch)(ThreadId tid) {
+  HChar thisFct[]="batch_thread_switch";
+  if (bufOf[tid] == NULL)
+    bufOf[tid] = VG_(malloc)(thisFct, OA_BATCH_MAX * sizeof(OA_BatchSlot));
+  curBuf = bufOf[tid];
+}
+
+VG_REGPARM(2) void OA_(batch_flush)(OA_BatchDesc d, HWord n) {
+  UChar need[OA_BATCH_MAX];
+  Int i;
+  screen_batch(curBuf, d->screen, need, (Int)n);
+  for (i=0; i<(Int)n; i++) {
+    if (!need[i]) continue;
+    if (d->nArgs[i] == 1)
+      ((oa_callback_1)d->callback[i])(curBuf[i].a, d->ic[i]);
+    else
+      ((oa_callback_2)d->callback[i])(curBuf[i].a, curBuf[i].b, d->ic[i]);
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Translation time                                             ---*/
+/*--------------------------------------------------------------------*/
+
+static void emit_flush(IRSB* sb, IRExpr* guard) {
+  HChar thisFct[]="batch_flush";
+  IRExpr** argv = mkIRExprVec_2(mkIRExpr_HWord((HWord)curDesc),
+                                mkIRExpr_HWord((HWord)curUsed));
+  IRDirty* di = unsafeIRDirty_0_N( 2, thisFct,
+                                   VG_(fnptr_to_fnentry)( OA_(batch_flush) ), argv);
+  guard = OA_(scope_and_guard)(sb, guard);
+  if (guard != NULL)
+    di->guard = guard;
+  addStmtToIRSB( sb, IRStmt_Dirty(di) );
+}
+
+void OA_(batch_begin_SB)(void) {
+  curDesc = NULL;
+  curUsed = 0;
+  curBase = IRTemp_INVALID;
+}
+
+/* The address of a field of the slot i of the running thread's buffer
+ * (--batch is amd64 only, so the addresses are I64) */
+static IRExpr* slot_addr(IRSB* sb, Int i, Int offset) {
+  IRTemp t;
+  if (curBase == IRTemp_INVALID) {
+    curBase = newIRTemp(sb->tyenv, Ity_I64);
+    addStmtToIRSB(sb, IRStmt_WrTmp(curBase, IRExpr_Load(Iend_LE, Ity_I64,
+                                   mkIRExpr_HWord((HWord)&curBuf))));
+  }
+  t = newIRTemp(sb->tyenv, Ity_I64);
+  addStmtToIRSB(sb, IRStmt_WrTmp(t, IRExpr_Binop(Iop_Add64, IRExpr_RdTmp(curBase),
+                mkIRExpr_HWord(i * sizeof(OA_BatchSlot) + offset))));
+  return IRExpr_RdTmp(t);
+}
+
+/* Adds the stores of one watched op; args[] are "flat" I64 expressions
+ * (args[1] is NULL for unary callbacks). */
+void OA_(batch_add_op)(IRSB* sb, IROp op, void* callback,
+                       IRExpr* arg1, IRExpr* arg2, OA_InstrumentContext ic) {
+  HChar thisFct[]="batch_add_op";
+  if (curUsed == OA_BATCH_MAX) {
+    emit_flush(sb, NULL);
+    curDesc = NULL;
+    curUsed = 0;
+  }
+  if (curDesc == NULL) {
+    curDesc = VG_(malloc)(thisFct, sizeof(struct _OA_BatchDesc));
+    OA_(group_own)(curDesc);
+    curUsed = 0;
+  }
+  curDesc->callback[curUsed] = callback;
+  curDesc->ic[curUsed]       = ic;
+  curDesc->nArgs[curUsed]    = (arg2 == NULL) ? 1 : 2;
+  curDesc->screen[curUsed]   = screenFromIROp(op);
+  addStmtToIRSB(sb, IRStmt_Store(Iend_LE,
+                slot_addr(sb, curUsed, offsetof(OA_BatchSlot, a)), arg1));
+  if (arg2 != NULL)
+    addStmtToIRSB(sb, IRStmt_Store(Iend_LE,
+                  slot_addr(sb, curUsed, offsetof(OA_BatchSlot, b)), arg2));
+  curUsed++;
+}
+
+/* Before a side exit: flush what was stored so far if the exit is taken.
+ * If it is not, the same slots are flushed again later with the rest. */
+void OA_(batch_before_exit)(IRSB* sb, IRExpr* guard) {
+  if (curUsed == 0) return;
+  emit_flush(sb, guard);
+}
+
+void OA_(batch_end_SB)(IRSB* sb) {
+  if (curUsed == 0) return;
+  emit_flush(sb, NULL);
+  curDesc = NULL;
+  curUsed = 0;
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
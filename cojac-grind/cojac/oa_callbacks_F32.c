@@ -60,17 +60,17 @@ static float ulpf(float a) { //PRE: a is neither INF nor NaN
 static void check_AddF32(Float a, Float b, OA_InstrumentContext inscon) {
   if (a==0.0f || b==0.0f) return;
   Float res=a+b;
-  if (res==a || res==b) {
+  if (OA_KIND_ON(Err_Precision) && (res==a || res==b)) {
     OA_(maybe_error)(Err_Precision, inscon); return;
   }
-  if (isinf(res) && !isinf(a) && !isinf(b)) {
+  if (OA_KIND_ON(Err_Infinity) && isinf(res) && !isinf(a) && !isinf(b)) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if (isnan(res) && !isnan(a) && !isnan(b)) {
+  if (OA_KIND_ON(Err_NaN) && isnan(res) && !isnan(a) && !isnan(b)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
   if (isnan(res) || isinf(res) || res==0.0f) return;
-  if(fabsf(res) <= OA_(options).Ulp_factor_f32 * ulpf(a)) {
+  if (OA_KIND_ON(Err_Cancellation) && fabsf(res) <= OA_(options).Ulp_factor_f32 * ulpf(a)) {
     OA_(maybe_error)(Err_Cancellation, inscon); return;
   }
 }
@@ -78,17 +78,17 @@ static void check_AddF32(Float a, Float b, OA_InstrumentContext inscon) {
 static void check_SubF32(Float a, Float b, OA_InstrumentContext inscon) {
   if (a==0.0f || b==0.0f) return;
   Float res=a-b;
-  if (res == a || res==b) {
+  if (OA_KIND_ON(Err_Precision) && (res == a || res==b)) {
     OA_(maybe_error)(Err_Precision, inscon); return;
   }
-  if (isinf(res) && !isinf(a) && !isinf(b)) {
+  if (OA_KIND_ON(Err_Infinity) && isinf(res) && !isinf(a) && !isinf(b)) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if (isnan(res) && !isnan(a) && !isnan(b)) {
+  if (OA_KIND_ON(Err_NaN) && isnan(res) && !isnan(a) && !isnan(b)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
   if (isnan(res) || isinf(res) || res==0.0f) return;
-  if(fabsf(res) <= OA_(options).Ulp_factor_f32 * ulpf(a)) {
+  if (OA_KIND_ON(Err_Cancellation) && fabsf(res) <= OA_(options).Ulp_factor_f32 * ulpf(a)) {
     OA_(maybe_error)(Err_Cancellation, inscon); return;
   }
 }
@@ -96,47 +96,67 @@ static void check_SubF32(Float a, Float b, OA_InstrumentContext inscon) {
 
 static void check_MulF32(Float a, Float b, OA_InstrumentContext inscon) {
   Float res=a*b;
-  if (isinf(res) && !isinf(a) && !isinf(b)) {
+  if (OA_KIND_ON(Err_Infinity) && isinf(res) && !isinf(a) && !isinf(b)) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if (isnan(res) && !isnan(a) && !isnan(b)) {
+  if (OA_KIND_ON(Err_NaN) && isnan(res) && !isnan(a) && !isnan(b)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
-  if(a!=0.0f && b!=0.0f && res == 0.0f) {
+  if (OA_KIND_ON(Err_Underflow) && a!=0.0f && b!=0.0f && res == 0.0f) {
     OA_(maybe_error)(Err_Underflow, inscon); return;
   }
   
 }
 
 static void check_DivF32(Float a, Float b, OA_InstrumentContext inscon) {
-  if (b==0.0f) {
+  if (OA_KIND_ON(Err_DivByZero) && b==0.0f) {
     OA_(maybe_error)(Err_DivByZero, inscon); return;
   }
   Float res=a/b;
-  if (isinf(res) && !isinf(a) && !isinf(b)) {
+  if (OA_KIND_ON(Err_Infinity) && isinf(res) && !isinf(a) && !isinf(b)) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if (isnan(res) && !isnan(a) && !isnan(b)) {
+  if (OA_KIND_ON(Err_NaN) && isnan(res) && !isnan(a) && !isnan(b)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
-  if(a!=0.0f && b!=0.0f && res == 0.0f) {
+  if (OA_KIND_ON(Err_Underflow) && a!=0.0f && b!=0.0f && res == 0.0f) {
     OA_(maybe_error)(Err_Underflow, inscon); return;
   }
 }
 
+static void check_CmpF32(Float a, Float b, OA_InstrumentContext inscon){
+  if (isnan(a) || isnan(b)) {
+    if (OA_KIND_ON(Err_NaN)) OA_(maybe_error)(Err_NaN, inscon);
+    return;
+  }
+  if(isinf(a) || isinf(b)){
+    return;
+  }
+  Float res = a - b;
+  if(res == 0){
+    return;
+  }
+  if (OA_KIND_ON(Err_CloseComparison) && fabsf(res) <= OA_(options).Ulp_factor_f32 * ulpf(a)) {
+    OA_(maybe_error)(Err_CloseComparison, inscon); return;
+  }
+  if (OA_KIND_ON(Err_CloseComparison) && fabsf(res) <= OA_(options).Ulp_factor_f32 * ulpf(b)) {
+    OA_(maybe_error)(Err_CloseComparison, inscon); return;
+  }
+}
+
 //See asin manpage.
 static void check_F32_Asin(Float a, OA_InstrumentContext inscon) {
-  if (a < -1 || a > 1){
+  if (OA_KIND_ON(Err_NaN) && (a < -1 || a > 1)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
 }
 
 //See log manpage. HUGE_VAL has the same effect than infinite.
 static void check_F32_Log(Float a, OA_InstrumentContext inscon) {
-  if (a == 0){
+  if (OA_KIND_ON(Err_Infinity) && a == 0) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if(a < 0){
+  if (OA_KIND_ON(Err_NaN) && a < 0) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
 }
@@ -147,7 +167,7 @@ static void check_F32_Sqrt(Float a, OA_InstrumentContext inscon) {
   }
   Float b;
   __asm__ ("sqrtss %1, %0" : "=x" (b) : "x" (a));
-  if (isnan(b)){
+  if (OA_KIND_ON(Err_NaN) && isnan(b)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
 }
@@ -181,6 +201,7 @@ VG_REGPARM(3) void oa_callbackI32_2xF32(UInt a, UInt b, OA_InstrumentContext ic)
     case Iop_MulF32:  check_MulF32(fa,fb,ic); break;
     case Iop_Div32F0x4: 
     case Iop_DivF32:  check_DivF32(fa,fb,ic); break;
+    case Iop_CmpF32:  check_CmpF32(fa,fb,ic); break;
     default: break;
   }
 }
@@ -192,6 +213,25 @@ VG_REGPARM(3) void oa_callbackI64_2xF32(ULong la, ULong lb, OA_InstrumentContext
   oa_callbackI32_2xF32(a1, b1,ic);
 }
 
+/* Packed compares (amd64 only): all the lanes are checked in one call;
+ * lane 0 is the low half of la0 */
+VG_REGPARM(3) void oa_callbackI64_cmp32F(ULong la0, ULong la1, ULong lb0, ULong lb1,
+                                         OA_InstrumentContext ic) {
+  Int a[4], b[4], i, nLanes;
+  switch(ic->op) {
+    case Iop_CmpEQ32F0x4: case Iop_CmpLT32F0x4: case Iop_CmpLE32F0x4:
+      nLanes=1; break;
+    default:
+      nLanes=4; break;
+  }
+  OA_(longToTwoInts)(la0, &a[1], &a[0]);
+  OA_(longToTwoInts)(la1, &a[3], &a[2]);
+  OA_(longToTwoInts)(lb0, &b[1], &b[0]);
+  OA_(longToTwoInts)(lb1, &b[3], &b[2]);
+  for (i=0; i<nLanes; i++)
+    check_CmpF32(OA_(floatFromInt)(a[i]), OA_(floatFromInt)(b[i]), ic);
+}
+
 
 /*--------------------------------------------------------------------*/
 /*--- end                                                          ---*/
@@ -60,17 +60,17 @@ static void check_AddF64(Double a, Double b, OA_InstrumentContext inscon) {
   //    longFromDouble(a), longFromDouble(b), inscon->string);
   if (a==0.0 || b==0.0) return;
   Double res=a+b;
-  if (res == a || res==b) {
+  if (OA_KIND_ON(Err_Precision) && (res == a || res==b)) {
     OA_(maybe_error)(Err_Precision, inscon); return;
   }
-  if (isinf(res) && !isinf(a) && !isinf(b)) {
+  if (OA_KIND_ON(Err_Infinity) && isinf(res) && !isinf(a) && !isinf(b)) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if (isnan(res) && !isnan(a) && !isnan(b)) {
+  if (OA_KIND_ON(Err_NaN) && isnan(res) && !isnan(a) && !isnan(b)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
   if (isnan(res) || isinf(res) || res==0.0) return;
-  if(fabs(res) <= OA_(options).Ulp_factor_f64 * ulp(a)) {
+  if (OA_KIND_ON(Err_Cancellation) && fabs(res) <= OA_(options).Ulp_factor_f64 * ulp(a)) {
     OA_(maybe_error)(Err_Cancellation, inscon); return;
   }
 }
@@ -78,79 +78,90 @@ static void check_AddF64(Double a, Double b, OA_InstrumentContext inscon) {
 static void check_SubF64(Double a, Double b, OA_InstrumentContext inscon) {
   if (a==0.0 || b==0.0) return;
   Double res=a-b;
-  if (res == a || res==b) {
+  if (OA_KIND_ON(Err_Precision) && (res == a || res==b)) {
     OA_(maybe_error)(Err_Precision, inscon); return;
   }
-  if (isinf(res) && !isinf(a) && !isinf(b)) {
+  if (OA_KIND_ON(Err_Infinity) && isinf(res) && !isinf(a) && !isinf(b)) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if (isnan(res) && !isnan(a) && !isnan(b)) {
+  if (OA_KIND_ON(Err_NaN) && isnan(res) && !isnan(a) && !isnan(b)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
   if (isnan(res) || isinf(res) || res==0.0) return;
-  if(fabs(res) <= OA_(options).Ulp_factor_f64 * ulp(a)) {
+  if (OA_KIND_ON(Err_Cancellation) && fabs(res) <= OA_(options).Ulp_factor_f64 * ulp(a)) {
     OA_(maybe_error)(Err_Cancellation, inscon); return;
   }
 }
 
 static void check_MulF64(Double a, Double b, OA_InstrumentContext inscon) {
   Double res=a*b;
-  if (isinf(res) && !isinf(a) && !isinf(b)) {
+  if (OA_KIND_ON(Err_Infinity) && isinf(res) && !isinf(a) && !isinf(b)) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if (isnan(res) && !isnan(a) && !isnan(b)) {
+  if (OA_KIND_ON(Err_NaN) && isnan(res) && !isnan(a) && !isnan(b)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
-  if(a!=0.0 && b!=0.0 && res == 0.0) {
+  if (OA_KIND_ON(Err_Underflow) && a!=0.0 && b!=0.0 && res == 0.0) {
     OA_(maybe_error)(Err_Underflow, inscon); return;
   }
 }
 
+// Diagnosis of a division whose result is already known.
+static Int diag_DivF64(Double a, Double b, Double res) {
+  if (OA_KIND_ON(Err_DivByZero) && b==0.0)                               return Err_DivByZero;
+  if (OA_KIND_ON(Err_Infinity)  && isinf(res) && !isinf(a) && !isinf(b)) return Err_Infinity;
+  if (OA_KIND_ON(Err_NaN)       && isnan(res) && !isnan(a) && !isnan(b)) return Err_NaN;
+  if (OA_KIND_ON(Err_Underflow) && a!=0.0 && b!=0.0 && res == 0.0)       return Err_Underflow;
+  return OA_NoError;
+}
+
 static void check_DivF64(Double a, Double b, OA_InstrumentContext inscon) {
-  if (b==0.0) {
-    OA_(maybe_error)(Err_DivByZero, inscon); return;
+  Int kind=diag_DivF64(a, b, a/b);
+  if (kind != OA_NoError)
+    OA_(maybe_error)(kind, inscon);
+}
+
+static void check_F64toI32S(Double a, OA_InstrumentContext inscon) {
+  if (OA_KIND_ON(Err_Overflow) && (a > INT_MAX || a < INT_MIN)) {
+    OA_(maybe_error)(Err_Overflow, inscon);
   }
-  Double res=a/b;
-  if (isinf(res) && !isinf(a) && !isinf(b)) {
+  if (OA_KIND_ON(Err_Infinity) && isinf(a)) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if (isnan(res) && !isnan(a) && !isnan(b)) {
+  if (OA_KIND_ON(Err_NaN) && isnan(a)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
-  if(a!=0.0 && b!=0.0 && res == 0.0) {
-    OA_(maybe_error)(Err_Underflow, inscon); return;
-  }
 }
 
-static void check_F64toI32S(Double a, OA_InstrumentContext inscon) {
-  if (a > INT_MAX || a < INT_MIN){
+static void check_F64toI64S(Double a, OA_InstrumentContext inscon) {
+  if (OA_KIND_ON(Err_Overflow) && (a > LONG_MAX || a < LONG_MIN)) {
     OA_(maybe_error)(Err_Overflow, inscon);
   }
-  if (isinf(a)){
+  if (OA_KIND_ON(Err_Infinity) && isinf(a)) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if (isnan(a)){
+  if (OA_KIND_ON(Err_NaN) && isnan(a)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
 }
 
-static void check_F64toI64S(Double a, OA_InstrumentContext inscon) {
-  if (a > LONG_MAX || a < LONG_MIN){
+static void check_F64toUnsigned(Double a, Double max, OA_InstrumentContext inscon) {
+  if (OA_KIND_ON(Err_Overflow) && (a >= max || a <= -1.0)) {
     OA_(maybe_error)(Err_Overflow, inscon);
   }
-  if (isinf(a)){
+  if (OA_KIND_ON(Err_Infinity) && isinf(a)) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if (isnan(a)){
+  if (OA_KIND_ON(Err_NaN) && isnan(a)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
 }
 
 static void check_F64toF32(Double a, OA_InstrumentContext inscon) {
-  if (a > FLT_MAX || a < -FLT_MAX){
+  if (OA_KIND_ON(Err_Overflow) && (a > FLT_MAX || a < -FLT_MAX)) {
     OA_(maybe_error)(Err_Overflow, inscon);
   }
-  if(a < FLT_MIN){
+  if(OA_KIND_ON(Err_Underflow) && a < FLT_MIN){
     Float fa = a;
     if(fa == 0.0f && a != 0.0)
       OA_(maybe_error)(Err_Underflow, inscon);
@@ -158,17 +169,22 @@ static void check_F64toF32(Double a, OA_InstrumentContext inscon) {
 }
 
 static void check_CmpF64(Double a, Double b, OA_InstrumentContext inscon){
-  if(isinf(a) || isinf(b) || isnan(a) || isnan(b)){
+  if (isnan(a) || isnan(b)) {
+    // always false (or "unordered"): most probably not what was meant
+    if (OA_KIND_ON(Err_NaN)) OA_(maybe_error)(Err_NaN, inscon);
+    return;
+  }
+  if(isinf(a) || isinf(b)){
     return;
   }
   Double res = a - b;
   if(res == 0){
     return;
   }
-  if(fabs(res) <= OA_(options).Ulp_factor_f64 * ulp(a)) {
+  if (OA_KIND_ON(Err_CloseComparison) && fabs(res) <= OA_(options).Ulp_factor_f64 * ulp(a)) {
     OA_(maybe_error)(Err_CloseComparison, inscon); return;
   }
-  if(fabs(res) <= OA_(options).Ulp_factor_f64 * ulp(b)) {
+  if (OA_KIND_ON(Err_CloseComparison) && fabs(res) <= OA_(options).Ulp_factor_f64 * ulp(b)) {
     OA_(maybe_error)(Err_CloseComparison, inscon); return;
   }
 }
@@ -176,28 +192,39 @@ static void check_CmpF64(Double a, Double b, OA_InstrumentContext inscon){
 //See asin manpage.
 static void check_F64_Asin(Double a, OA_InstrumentContext inscon) {
   //Double b = asin(a);  //Line to uncomment to see the link error.
-  if (a < -1 || a > 1){
+  if (OA_KIND_ON(Err_NaN) && (a < -1 || a > 1)) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
 }
 
 //See log manpage. HUGE_VAL has the same effect than infinite.
 static void check_F64_Log(Double a, OA_InstrumentContext inscon) {
-  if (a == 0){
+  if (OA_KIND_ON(Err_Infinity) && a == 0) {
     OA_(maybe_error)(Err_Infinity, inscon); return;
   }
-  if(a < 0){
+  if (OA_KIND_ON(Err_NaN) && a < 0) {
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
 }
 
+static Double sqrtF64(Double a) {
+  Double b;
+  __asm__ ("sqrtsd %1, %0" : "=x" (b) : "x" (a));
+  return b;
+}
+
+// Diagnosis of a square root whose result is already known.
+static Int diag_SqrtF64(Double a, Double res) {
+  if (isnan(a) || isinf(a))             return OA_NoError;
+  if (OA_KIND_ON(Err_NaN) && isnan(res)) return Err_NaN;
+  return OA_NoError;
+}
+
 static void check_F64_Sqrt(Double a, OA_InstrumentContext inscon) {
   if(isnan(a) || isinf(a)){
     return;
   }
-  Double b;
-  __asm__ ("sqrtsd %1, %0" : "=x" (b) : "x" (a));
-  if (isnan(b)){
+  if (diag_SqrtF64(a, sqrtF64(a)) != OA_NoError){
     OA_(maybe_error)(Err_NaN, inscon); return;
   }
 }
@@ -227,8 +254,11 @@ VG_REGPARM(2) void oa_callbackI64_1xF64(ULong la, OA_InstrumentContext ic) {
 VG_REGPARM(3) void oa_callbackI64_1xI32_1xF64(UInt roundingMode, ULong la, OA_InstrumentContext ic) {
   Double value = OA_(doubleFromULong)(la);
   switch(ic->op) {
+    case Iop_F32toI32S: // the F32 is passed widened
     case Iop_F64toI32S: check_F64toI32S(value, ic); break;
     case Iop_F64toI64S: check_F64toI64S(value, ic); break;
+    case Iop_F64toI32U: check_F64toUnsigned(value, 4294967296.0, ic); break;
+    case Iop_F64toI64U: check_F64toUnsigned(value, 18446744073709551616.0, ic); break;
     case Iop_F64toF32: check_F64toF32(value, ic); break;
 	  default: break;
 	}
@@ -268,6 +298,55 @@ VG_REGPARM(3) void oa_callbackI64_2xF64(ULong la, ULong lb, OA_InstrumentContext
 }
 
 
+/* Packed compares (amd64 only): all the lanes are checked in one call */
+VG_REGPARM(3) void oa_callbackI64_cmp64F(ULong la0, ULong la1, ULong lb0, ULong lb1,
+                                         OA_InstrumentContext ic) {
+  check_CmpF64(OA_(doubleFromULong)(la0), OA_(doubleFromULong)(lb0), ic);
+  switch(ic->op) {
+    case Iop_CmpEQ64F0x2: case Iop_CmpLT64F0x2: case Iop_CmpLE64F0x2:
+      break;
+    default:
+      check_CmpF64(OA_(doubleFromULong)(la1), OA_(doubleFromULong)(lb1), ic);
+      break;
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/* "Fused" helpers (--fusedOps=yes, amd64 only): the instrumented code
+ * no longer executes the operation itself, the helper returns the result
+ * of one lane and leaves its diagnosis in OA_(fused_status). A guarded
+ * call to oa_fused_report then signals it, only when something was found.
+ * The status keeps the first error of the lanes of one operation. */
+
+UInt OA_(fused_status) = 0;  // 0 when clean, else OA_ErrorTag+1
+
+static void fused_signal(Int kind) {
+  if (kind != OA_NoError && OA_(fused_status) == 0)
+    OA_(fused_status) = kind+1;
+}
+
+VG_REGPARM(2) ULong oa_fusedI64_DivF64(ULong la, ULong lb) {
+  Double a=OA_(doubleFromULong)(la);
+  Double b=OA_(doubleFromULong)(lb);
+  Double res=a/b;
+  fused_signal(diag_DivF64(a, b, res));
+  return OA_(ulongFromDouble)(res);
+}
+
+VG_REGPARM(1) ULong oa_fusedI64_SqrtF64(ULong la) {
+  Double a=OA_(doubleFromULong)(la);
+  Double res=sqrtF64(a);
+  fused_signal(diag_SqrtF64(a, res));
+  return OA_(ulongFromDouble)(res);
+}
+
+VG_REGPARM(1) void oa_fused_report(OA_InstrumentContext ic) {
+  UInt status=OA_(fused_status);
+  OA_(fused_status)=0;
+  if (status != 0)
+    OA_(maybe_error)(status-1, ic);
+}
+
 /* x86 platform only !
  * As only Int32 can be passed to the callback, the trick here is
  * to split the callback in 2 successive calls.
@@ -287,8 +366,11 @@ VG_REGPARM(1) void oa_callbackI32_1xF64(UInt a, OA_InstrumentContext ic){
   VG_(printf)("X86 platform not fully implemented yet\n");
 }
 
-VG_REGPARM(2) void oa_callbackI32_1xI32_1xF64(UInt roundingMode, UInt la, OA_InstrumentContext ic){
-  VG_(printf)("X86 platform not fully implemented yet\n");
+/* x86: the value comes in two halves, and the call is not regparm (an I64
+ * can't be passed in registers there), see instrument_FPNarrowing */
+void oa_callbackI32_1xI32_1xF64(UInt roundingMode, UInt hi, UInt lo, OA_InstrumentContext ic){
+  ULong la=OA_(ulongFromTwoInts)(hi, lo);
+  oa_callbackI64_1xI32_1xF64(roundingMode, la, ic);
 }
 
 VG_REGPARM(3) void oa_callbackI32_2xF64(UInt a, UInt b, OA_InstrumentContext ic) {
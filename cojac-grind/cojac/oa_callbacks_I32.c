@@ -93,32 +93,10 @@ static void check_MullS32(Int a, Int b, OA_InstrumentContext inscon) {
   }
 }
 
-static void check_DivS32(Int a, Int b, OA_InstrumentContext inscon) {
-  if (b==0) {
-    OA_(maybe_error)(Err_DivByZero, inscon);
-  } else if (b==-1 && a==INT_MIN) {
-    OA_(maybe_error)(Err_Overflow, inscon);
-  }
-}
-
-//check_32to16 is never watched by Valgrind. The compalitor use the registers to do the cast.
-static void check_32to16(Int a, OA_InstrumentContext inscon) {
-  if(a>SHRT_MAX || a<SHRT_MIN)
-    OA_(maybe_error)(Err_Cast, inscon);
-}
-
 //-----------------------------------------------------------------
 /* These are called from the instrumented code, just before the operation. TODOs*/
 //-----------------------------------------------------------------
 
-VG_REGPARM(2) void oa_callbackI32_1x32(Int a, OA_InstrumentContext ic) {
-  switch(ic->op) {
-    case Iop_32to16:  check_32to16(a,ic);
-    OA_(maybe_error)(Err_Cast, ic); break;
-    default: break;
-  }
-}
-
 VG_REGPARM(3) void oa_callbackI32_2x32(Int a, Int b, OA_InstrumentContext ic) {
   UInt ua=OA_(uintFromInt)(a);
   UInt ub=OA_(uintFromInt)(b);
@@ -126,19 +104,16 @@ VG_REGPARM(3) void oa_callbackI32_2x32(Int a, Int b, OA_InstrumentContext ic) {
     case Iop_Add32:  check_Add32(a,b,ic);   break;
     case Iop_Sub32:  check_Sub32(a,b,ic);   break;
     case Iop_Mul32:  check_Mul32(ua,ub,ic); break;
-    case Iop_DivS32: check_DivS32(a,b,ic);  break;  //not that relevant (widening mul)
     case Iop_MullS32:check_MullS32(a,b,ic); break;
     default: break;
   }
 }
 
-VG_REGPARM(2) void oa_callbackI64_1x32(ULong la, OA_InstrumentContext ic) {
-  Int a, a1;
-  OA_(longToTwoInts)(la, &a, &a1);
-  oa_callbackI32_1x32(a,ic);
+/* Integer divisions, narrowing casts: the guard computed inline already holds */
+VG_REGPARM(2) void oa_inline_report(HWord kind, OA_InstrumentContext ic) {
+  OA_(maybe_error)((ErrorKind)kind, ic);
 }
 
-
 VG_REGPARM(3) void oa_callbackI64_2x32(ULong la, ULong lb, OA_InstrumentContext ic) {
   Int a, a1, b, b1;
   OA_(longToTwoInts)(la, &a, &a1);
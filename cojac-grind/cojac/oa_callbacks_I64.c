@@ -84,27 +84,7 @@ static void check_MullS64(Long a, Long b, OA_InstrumentContext inscon) {
   }
 }
 
-static void check_DivS64(Long a, Long b, OA_InstrumentContext inscon) {
-  if (b==0) {
-    OA_(maybe_error)(Err_DivByZero, inscon);
-  } else if (b==-1L && a==LONG_MIN) {
-    OA_(maybe_error)(Err_Overflow, inscon);
-  }
-}
-
-static void check_64to32(Long a, OA_InstrumentContext inscon) {
-  if(a>INT_MAX || a<INT_MIN)
-    OA_(maybe_error)(Err_Cast, inscon);
-}
-
 /*--------------------------------------------------------------------*/
-VG_REGPARM(2) void oa_callbackI64_1x64(Long a, OA_InstrumentContext ic) {
-  switch(ic->op) {
-    case Iop_64to32:  check_64to32(a,ic); break;
-    default: break;
-  }
-}
-
 VG_REGPARM(3) void oa_callbackI64_2x64(Long a, Long b, OA_InstrumentContext ic) {
 	oa_mix64_t m;
 	ULong ua; m.s=a; ua=m.u;
@@ -118,7 +98,6 @@ VG_REGPARM(3) void oa_callbackI64_2x64(Long a, Long b, OA_InstrumentContext ic)
     case Iop_Mul64:  check_Mul64(a,b,ic); break;
     case Iop_MullS64: check_MullS64(a,b,ic); break;
     //case Iop_Div64x2:
-    case Iop_DivS64:  check_DivS64(a,b,ic); break;
     default: break;
   }
 }
@@ -135,19 +114,6 @@ VG_REGPARM(3) void oa_callbackI64_2x64(Long a, Long b, OA_InstrumentContext ic)
 static partOfF64op add64_buf;
 static char        isAdd64Part=False;
 
-VG_REGPARM(2) void oa_callbackI32_1x64(UInt a, OA_InstrumentContext ic) {
-  if (isAdd64Part) { // second half of the callback
-    isAdd64Part=False;
-    oa_mix64_t m;
-    Long la; m.halves.h1.s=a; m.halves.h2.s=add64_buf.a; la=m.s;
-    oa_callbackI64_1x64(la, ic);
-  } else {            // first half of the callback
-    isAdd64Part=True;
-    add64_buf.a=a;
-    add64_buf.tid=VG_(get_running_tid)();
-  }
-}
-
 VG_REGPARM(3) void oa_callbackI32_2x64(UInt a, UInt b, OA_InstrumentContext ic) {
   if (isAdd64Part) { // second half of the callback
     isAdd64Part=False;
@@ -0,0 +1,225 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.            oa_callctx ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* Calling contexts (--call-contexts=yes).
+ *
+ * Each thread has a shadow call stack, as in callgrind: every superblock
+ * ending with a call pushes the call site (and the SP at the callee
+ * entry), every superblock ending with a return pops the frames that have
+ * been left, like OA_(scope_ret) does. VEX is told not to chase into the
+ * callees, so that no call is hidden inside a superblock.
+ *
+ * The stack carries a context id, a hash of its call sites updated at
+ * each push (and given back at each pop), so that an event knows its
+ * calling context in O(1). An error is reported once per (site, context
+ * id, kind), with a stack trace made of the shadow stack instead of an
+ * unwind; its repetitions are only counted in the site table. Two
+ * contexts with the same hash are merged.
+ *
+ * Frames deeper than OA_CTX_MAX are not pushed: their events are seen in
+ * the context of the deepest frame kept. A call from the same site as the
+ * frame below it (direct recursion) keeps the context id, and is shown
+ * once in the stack trace, so that a recursion does not make a context
+ * per level. At most OA_CTX_SEEN_MAX contexts are reported, the errors in
+ * the next ones are only counted in the site table. The stack of a thread
+ * is emptied when it exits and when its id is given to a new thread.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "pub_tool_libcbase.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_execontext.h"
+#include "pub_tool_hashtable.h"
+#include "pub_tool_mallocfree.h"
+#include "pub_tool_options.h"     // VG_(clo_vex_control)
+#include "pub_tool_threadstate.h"
+#include "pub_tool_machine.h"     // VG_(fnptr_to_fnentry)
+#include "oa_include.h"
+
+/*--------------------------------------------------------------------*/
+#define OA_CTX_MAX      1024
+#define OA_CTX_SEEN_MAX 100000
+
+typedef struct {
+  Addr  sp;        // at the callee entry
+  Addr  callSite;
+  UWord ctx;       // context id of the caller
+} OA_Frame;
+
+typedef struct {
+  OA_Frame frames[OA_CTX_MAX];
+  UInt     depth;
+  UWord    ctx;
+} OA_ShadowStack;
+
+typedef struct _OA_CtxSeen {
+  struct _OA_CtxSeen* next;   // VgHashNode layout
+  UWord key;                  // hash of (site, context id, kind)
+} OA_CtxSeen;
+
+static OA_ShadowStack* stackOf[VG_N_THREADS];  // allocated at first run
+static OA_ShadowStack* curStack = NULL;
+static VgHashTable     seen = NULL;
+static UInt            nSeen = 0;
+static Bool            seenFull = False;
+
+static __inline__ UWord mix(UWord h, UWord v) {
+#if VG_WORDSIZE == 8
+  h = (h ^ v) * 0x9E3779B97F4A7C15ULL;
+  return h ^ (h >> 29);
+#else
+  h = (h ^ v) * 0x9E3779B9U;
+  return h ^ (h >> 15);
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Runtime                                                      ---*/
+/*--------------------------------------------------------------------*/
+
+void OA_(callctx_thread_switch)(ThreadId tid) {
+  HChar thisFct[]="callctx_thread_switch";
+  if (stackOf[tid] == NULL) {
+    stackOf[tid] = VG_(malloc)(thisFct, sizeof(OA_ShadowStack));
+    stackOf[tid]->depth = 0;
+    stackOf[tid]->ctx   = 0;
+  }
+  curStack = stackOf[tid];
+}
+
+static void thread_reset(ThreadId tid) {
+  if (stackOf[tid] == NULL) return;
+  stackOf[tid]->depth = 0;
+  stackOf[tid]->ctx   = 0;
+}
+
+static void thread_create(ThreadId parent, ThreadId child) {
+  thread_reset(child);
+}
+
+/* Pops the frames whose SP is below sp (or equal, when strict is False) */
+static void pop_frames(OA_ShadowStack* s, Addr sp, Bool strict) {
+  while (s->depth > 0 && (s->frames[s->depth-1].sp < sp
+                          || (!strict && s->frames[s->depth-1].sp == sp))) {
+    s->depth--;
+    s->ctx = s->frames[s->depth].ctx;
+  }
+}
+
+/* sp is the stack pointer at the callee entry; a frame at or above it
+ * has been left by a longjmp */
+static VG_REGPARM(2) void callctx_call(HWord callSite, HWord sp) {
+  OA_ShadowStack* s = curStack;
+  OA_Frame* f;
+  pop_frames(s, (Addr)sp, False);
+  if (s->depth >= OA_CTX_MAX) return;
+  f = &s->frames[s->depth++];
+  f->sp       = (Addr)sp;
+  f->callSite = (Addr)callSite;
+  f->ctx      = s->ctx;
+  if (s->depth < 2 || s->frames[s->depth-2].callSite != f->callSite)
+    s->ctx    = mix(s->ctx, (UWord)callSite);
+}
+
+/* sp is the stack pointer after the return */
+static VG_REGPARM(1) void callctx_ret(HWord sp) {
+  pop_frames(curStack, (Addr)sp, True);
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Translation time                                             ---*/
+/*--------------------------------------------------------------------*/
+
+void OA_(callctx_init)(void) {
+  seen = VG_(HT_construct)("cojac.callctx");
+  VG_(track_pre_thread_ll_create)(thread_create);
+  VG_(track_pre_thread_ll_exit)(thread_reset);
+  // a call must end its superblock to be seen
+  VG_(clo_vex_control).guest_chase_thresh = 0;
+}
+
+/* At the end of the SB, whose last instruction is at cia */
+void OA_(callctx_end_SB)(IRSB* sb, Addr64 cia, VexGuestLayout* layout,
+                         IRType gWordTy) {
+  IRDirty* di;
+  IRTemp   sp;
+  if (sb->jumpkind != Ijk_Call && sb->jumpkind != Ijk_Ret) return;
+  sp = newIRTemp(sb->tyenv, gWordTy);
+  addStmtToIRSB(sb, IRStmt_WrTmp(sp, IRExpr_Get(layout->offset_SP, gWordTy)));
+  if (sb->jumpkind == Ijk_Call)
+    di = unsafeIRDirty_0_N(2, "callctx_call", VG_(fnptr_to_fnentry)(callctx_call),
+                           mkIRExprVec_2(mkIRExpr_HWord((HWord)cia), IRExpr_RdTmp(sp)));
+  else
+    di = unsafeIRDirty_0_N(1, "callctx_ret", VG_(fnptr_to_fnentry)(callctx_ret),
+                           mkIRExprVec_1(IRExpr_RdTmp(sp)));
+  addStmtToIRSB(sb, IRStmt_Dirty(di));
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Errors                                                       ---*/
+/*--------------------------------------------------------------------*/
+
+/* Whether the error (site, kind) is the first one in the current context */
+Bool OA_(callctx_first)(Addr site, ErrorKind kind) {
+  HChar thisFct[]="callctx_first";
+  UWord key = mix(mix(curStack->ctx, (UWord)site), (UWord)kind);
+  OA_CtxSeen* n;
+  if (VG_(HT_lookup)(seen, key) != NULL) return False;
+  if (nSeen == OA_CTX_SEEN_MAX) {
+    if (!seenFull)
+      VG_(umsg)("Cojac: more than %d error contexts, the next ones are only "
+                "counted per site\n", OA_CTX_SEEN_MAX);
+    seenFull = True;
+    return False;
+  }
+  nSeen++;
+  n = VG_(malloc)(thisFct, sizeof(OA_CtxSeen));
+  n->key = key;
+  VG_(HT_add_node)(seen, n);
+  return True;
+}
+
+/* The stack trace of an error at site: the site, then the call sites of
+ * the shadow stack (a direct recursion once), at most depth entries in all */
+ExeContext* OA_(callctx_where)(Addr site, Int depth) {
+  Addr ips[OA_CTX_MAX + 1];
+  UInt n = 0;
+  Int  i;
+  ips[n++] = site;
+  for (i = curStack->depth - 1; i >= 0 && n < (UInt)depth; i--)
+    if (n == 1 || ips[n-1] != curStack->frames[i].callSite)
+      ips[n++] = curStack->frames[i].callSite;
+  return VG_(make_ExeContext_from_StackTrace)(ips, n);
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
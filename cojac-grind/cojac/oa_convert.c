@@ -0,0 +1,201 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.            oa_convert ---*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* Precision-conversion profile (--conversion-profile=yes).
+ *
+ * Each conversion between F32, F64 and the integers (cvtss2sd, cvtsd2ss,
+ * cvtsi2sd, cvttsd2si, ...) gets an inline counter of its executions.
+ * The narrowing ones (F64toF32, F64toI32S/U, F64toI64S/U) get a second
+ * counter, of the values that come out unchanged: converting the result
+ * back gives the operand again. Such a value had already been widened
+ * before, so it is a round trip that could have been avoided by keeping
+ * the narrower type (or the wider one) all along.
+ *
+ * As for the other inline counters, the increment is the scope guard (or
+ * 1) and the predicate, without a branch. The sites are keyed by address
+ * and conversion (an instruction can do two of them, eg. cvtsi2ss is
+ * I32StoF64 then F64toF32), and never freed. At exit they are listed by
+ * decreasing number of executions.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "pub_tool_libcbase.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_debuginfo.h"
+#include "pub_tool_hashtable.h"
+#include "pub_tool_mallocfree.h"
+#include "oa_include.h"
+
+/*--------------------------------------------------------------------*/
+typedef struct _OA_ConvSite {
+  struct _OA_ConvSite* next;    // VgHashNode layout
+  UWord        key;             // address << 4 | conversion
+  Addr         addr;
+  const HChar* what;
+  Bool         narrowing;
+  ULong        execs;
+  ULong        unchanged;       // narrowing only
+} OA_ConvSite;
+
+static VgHashTable convSites = NULL;
+
+static const struct {
+  IROp         op;
+  const HChar* name;
+  Bool         narrowing;
+} convOps[] = {
+  { Iop_F32toF64,  "F32toF64",  False },
+  { Iop_F64toF32,  "F64toF32",  True  },
+  { Iop_I32StoF64, "I32StoF64", False },
+  { Iop_I32UtoF64, "I32UtoF64", False },
+  { Iop_I64StoF64, "I64StoF64", False },
+  { Iop_I64UtoF64, "I64UtoF64", False },
+  { Iop_I32StoF32, "I32StoF32", False },
+  { Iop_I32UtoF32, "I32UtoF32", False },
+  { Iop_I64StoF32, "I64StoF32", False },
+  { Iop_I64UtoF32, "I64UtoF32", False },
+  { Iop_F64toI32S, "F64toI32S", True  },
+  { Iop_F64toI32U, "F64toI32U", True  },
+  { Iop_F64toI64S, "F64toI64S", True  },
+  { Iop_F64toI64U, "F64toI64U", True  },
+};
+#define N_CONV_OPS (sizeof(convOps)/sizeof(convOps[0]))
+
+static Int convIndex(IROp op) {
+  Int i;
+  for (i = 0; i < N_CONV_OPS; i++)
+    if (convOps[i].op == op) return i;
+  return -1;
+}
+
+void OA_(convert_init)(void) {
+  convSites = VG_(HT_construct)("cojac.convert");
+}
+
+Bool OA_(convert_watched)(IROp op) {
+  return convIndex(op) >= 0;
+}
+
+static OA_ConvSite* conv_site(Addr addr, Int idx) {
+  HChar thisFct[]="conv_site";
+  UWord key = ((UWord)addr << 4) | (UWord)idx;
+  OA_ConvSite* s = VG_(HT_lookup)(convSites, key);
+  if (s == NULL) {
+    s = VG_(calloc)(thisFct, 1, sizeof(OA_ConvSite));
+    s->key       = key;
+    s->addr      = addr;
+    s->what      = convOps[idx].name;
+    s->narrowing = convOps[idx].narrowing;
+    VG_(HT_add_node)(convSites, s);
+  }
+  return s;
+}
+
+/*--------------------------------------------------------------------*/
+static IRExpr* incOf(IRSB* sb, IRExpr* i1) {
+  IRExpr* b = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, i1));
+  return OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(Iop_32Uto64, b));
+}
+
+// the result r of a narrowing conversion, converted back to F64
+static IRExpr* backToF64(IRSB* sb, IROp op, IRExpr* rm, IRExpr* r) {
+  switch(op) {
+    case Iop_F64toF32: return OA_(newTmp)(sb, Ity_F64, IRExpr_Unop(Iop_F32toF64, r));
+    case Iop_F64toI32S: return OA_(newTmp)(sb, Ity_F64, IRExpr_Unop(Iop_I32StoF64, r));
+    case Iop_F64toI32U: return OA_(newTmp)(sb, Ity_F64, IRExpr_Unop(Iop_I32UtoF64, r));
+    case Iop_F64toI64S: return OA_(newTmp)(sb, Ity_F64, IRExpr_Binop(Iop_I64StoF64, rm, r));
+    case Iop_F64toI64U: return OA_(newTmp)(sb, Ity_F64, IRExpr_Binop(Iop_I64UtoF64, rm, r));
+    default: tl_assert(0);
+  }
+}
+
+/* Adds the counters of the (already added) statement st, if it is a
+ * conversion */
+void OA_(convert_profile)(IRSB* sb, IRStmt* st, OA_InstrumentContext ic) {
+  IRExpr* e = st->Ist.WrTmp.data;
+  IRExpr* r = IRExpr_RdTmp(st->Ist.WrTmp.tmp);
+  Int     idx = convIndex(ic->op);
+  OA_ConvSite* s;
+  IRExpr *scope, *inc, *back, *cmp, *same;
+  if (idx < 0) return;
+  s = conv_site(ic->addr, idx);
+  scope = OA_(scope_guard)(sb);
+  inc = scope != NULL ? incOf(sb, scope) : IRExpr_Const(IRConst_U64(1));
+  OA_(add_to)(sb, &s->execs, inc);
+  if (!s->narrowing) return;
+  back = backToF64(sb, ic->op, e->Iex.Binop.arg1, r);
+  cmp  = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_CmpF64, back, e->Iex.Binop.arg2));
+  same = OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpEQ32, cmp,
+                                              IRExpr_Const(IRConst_U32(Ircr_EQ))));
+  OA_(add_to)(sb, &s->unchanged, incOf(sb, OA_(scope_and_guard)(sb, same)));
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Report                                                       ---*/
+/*--------------------------------------------------------------------*/
+
+static Int cmp_conv_execs(const void* a, const void* b) {
+  const OA_ConvSite* x = *(const OA_ConvSite* const*)a;
+  const OA_ConvSite* y = *(const OA_ConvSite* const*)b;
+  if (x->execs != y->execs) return x->execs < y->execs ? 1 : -1;
+  return x->key < y->key ? -1 : x->key > y->key ? 1 : 0;
+}
+
+void OA_(convert_fini)(void) {
+  OA_ConvSite** sorted;
+  UInt  i, n;
+  ULong execs = 0, unchanged = 0;
+  if (convSites == NULL) return;
+  sorted = (OA_ConvSite**)VG_(HT_to_array)(convSites, &n);
+  VG_(ssort)(sorted, n, sizeof(OA_ConvSite*), cmp_conv_execs);
+  VG_(umsg)("Cojac: precision conversions by site\n");
+  for (i = 0; i < n && sorted[i]->execs > 0; i++) {
+    OA_ConvSite* s = sorted[i];
+    HChar fn[COJAC_FCT_LEN];
+    HChar file[COJAC_FILE_LEN];
+    UInt  lineNo;
+    OA_(site_location)(s->addr, fn, file, &lineNo);
+    if (s->narrowing)
+      VG_(umsg)("  %12llu %s   at %#lx: %s (%s:%u), %llu unchanged\n", s->execs,
+                s->what, s->addr, fn, file, lineNo, s->unchanged);
+    else
+      VG_(umsg)("  %12llu %s   at %#lx: %s (%s:%u)\n", s->execs,
+                s->what, s->addr, fn, file, lineNo);
+    execs     += s->execs;
+    unchanged += s->unchanged;
+  }
+  VG_(umsg)("Cojac: %llu conversions, %llu narrowed a value back unchanged\n",
+            execs, unchanged);
+  VG_(free)(sorted);
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,422 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.              oa_count ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* Counting mode (--mode=count).
+ *
+ * No helper is called at all: each watched operation is followed by IR
+ * predicates computed on its operands and its result, and each predicate
+ * is added (0 or 1, without a branch) to the counter of its site, ie. the
+ * count field of the (address, kind) entry of the site table. The entries
+ * are created at instrumentation time and never freed, so the counters of
+ * a retranslated block go on with the same entries. Nothing goes through
+ * the error manager; the table is printed, sorted, at exit.
+ *
+ * Only the kinds that are plain comparisons are counted: overflow, cast,
+ * division by zero, NaN, infinity, precision (smearing) and underflow.
+ * Cancellation and close comparisons need the ulp of an operand, and the
+ * calls to the math functions need a helper: they are not counted.
+ *
+ * The predicates are built as I32 values 0/1 ("bits"), so that they can
+ * be combined with And32/Or32/Xor32.
+ *
+ * With --hot-tier=guard, the same predicates are used in report mode:
+ * each one guards a report in the hot executions of its superblock (see
+ * OA_(guard_result)) instead of being counted.
+ *
+ * The same counters are used in both modes for the subnormal operands and
+ * results (--kinds=...,subnormal): they are no error, but the x86 FPUs
+ * handle them with microcode assists, 10 to 100 times slower. The sites
+ * are printed, as a hotspot table, at exit.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "oa_include.h"
+
+/*--------------------------------------------------------------------*/
+static Bool    reporting   = False;  // OA_(guard_result): report, do not count
+static IRExpr* reportGuard = NULL;   // and'ed with the reports
+
+static IRExpr* bit(IRSB* sb, IRExpr* i1) {
+  return OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, i1));
+}
+
+static IRExpr* bAnd(IRSB* sb, IRExpr* b1, IRExpr* b2) {
+  return OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32, b1, b2));
+}
+
+static IRExpr* bOr(IRSB* sb, IRExpr* b1, IRExpr* b2) {
+  return OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Or32, b1, b2));
+}
+
+static IRExpr* bNot(IRSB* sb, IRExpr* b) {
+  return OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Xor32, b, IRExpr_Const(IRConst_U32(1))));
+}
+
+/* The counter of the site is incremented by the guard */
+void OA_(count_if)(IRSB* sb, IRExpr* guard, ErrorKind kind, OA_InstrumentContext ic) {
+  guard = OA_(scope_and_guard)(sb, guard);
+  OA_(add_bit)(sb, OA_(site_counter)(ic, kind), bit(sb, guard));
+}
+
+static void count_bit(IRSB* sb, IRExpr* b, ErrorKind kind, OA_InstrumentContext ic) {
+  IRExpr* g;
+  if (reporting)
+    b = bAnd(sb, b, bit(sb, reportGuard));
+  g = OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpNE32, b, IRExpr_Const(IRConst_U32(0))));
+  if (reporting)
+    OA_(report_if)(sb, g, kind, ic);
+  else
+    OA_(count_if)(sb, g, kind, ic);
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Integer overflows                                            ---*/
+/*--------------------------------------------------------------------*/
+
+// sign bit of an I32 or I64 (x86 hosts have no 64-bit signed compare)
+static IRExpr* negative(IRSB* sb, IRExpr* x, IRType ty) {
+  if (ty == Ity_I64)
+    x = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_64HIto32, x));
+  return bit(sb, OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpLT32S, x,
+                                                      IRExpr_Const(IRConst_U32(0)))));
+}
+
+// signed overflow of r = a+b or r = a-b, from the signs
+static IRExpr* addSubOverflow(IRSB* sb, IROp op, IRExpr* a, IRExpr* b, IRExpr* r) {
+  Bool    is64 = (op == Iop_Add64 || op == Iop_Sub64);
+  IROp    xor  = is64 ? Iop_Xor64 : Iop_Xor32;
+  IROp    andOp= is64 ? Iop_And64 : Iop_And32;
+  IRType  ty   = is64 ? Ity_I64 : Ity_I32;
+  IRExpr* x1 = OA_(newTmp)(sb, ty, IRExpr_Binop(xor, a, r));
+  IRExpr* x2 = OA_(newTmp)(sb, ty, (op == Iop_Add32 || op == Iop_Add64)
+                                   ? IRExpr_Binop(xor, b, r)
+                                   : IRExpr_Binop(xor, a, b));
+  return negative(sb, OA_(newTmp)(sb, ty, IRExpr_Binop(andOp, x1, x2)), ty);
+}
+
+// I16 ops computed in I32, the result must be the same
+static IRExpr* i16Overflow(IRSB* sb, IROp op, IRExpr* a, IRExpr* b, IRExpr* r) {
+  IROp op32 = op == Iop_Add16 ? Iop_Add32 : op == Iop_Sub16 ? Iop_Sub32 : Iop_Mul32;
+  a = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_16Sto32, a));
+  b = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_16Sto32, b));
+  r = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_16Sto32, r));
+  IRExpr* w = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(op32, a, b));
+  return bit(sb, OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpNE32, w, r)));
+}
+
+// as check_Mul32/check_Mul64: the unsigned product does not fit
+static IRExpr* mulOverflow(IRSB* sb, IROp op, IRExpr* a, IRExpr* b) {
+  IRExpr* hi;
+  if (op == Iop_Mul32) {
+    IRExpr* p = OA_(newTmp)(sb, Ity_I64, IRExpr_Binop(Iop_MullU32, a, b));
+    hi = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_64HIto32, p));
+    return bit(sb, OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpNE32, hi,
+                                                        IRExpr_Const(IRConst_U32(0)))));
+  }
+  IRExpr* p = OA_(newTmp)(sb, Ity_I128, IRExpr_Binop(Iop_MullU64, a, b));
+  hi = OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(Iop_128HIto64, p));
+  return bit(sb, OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpNE64, hi,
+                                                      IRExpr_Const(IRConst_U64(0)))));
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Floating point                                               ---*/
+/*--------------------------------------------------------------------*/
+
+typedef enum { FP_AddSub, FP_Mul, FP_Div } FPClass;
+
+static IRExpr* cmpIs(IRSB* sb, IRExpr* a, IRExpr* b, IRCmpF64Result res) {
+  IRExpr* c = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_CmpF64, a, b));
+  return bit(sb, OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpEQ32, c,
+                                                      IRExpr_Const(IRConst_U32(res)))));
+}
+
+static IRExpr* isNaN(IRSB* sb, IRExpr* x) {
+  return cmpIs(sb, x, x, Ircr_UN);
+}
+
+static IRExpr* isZero(IRSB* sb, IRExpr* x) {
+  return cmpIs(sb, x, IRExpr_Const(IRConst_F64i(0)), Ircr_EQ);
+}
+
+static IRExpr* isInf(IRSB* sb, IRExpr* x) {
+  IRExpr* abs = OA_(newTmp)(sb, Ity_F64, IRExpr_Unop(Iop_AbsF64, x));
+  return cmpIs(sb, abs, IRExpr_Const(IRConst_F64i(0x7FF0000000000000ULL)), Ircr_EQ);
+}
+
+// the same diagnosis as check_AddF64, check_MulF64 and diag_DivF64
+static void count_fp(IRSB* sb, FPClass cls, IRExpr* a, IRExpr* b, IRExpr* r,
+                     OA_InstrumentContext ic) {
+  if (cls == FP_AddSub && OA_KIND_ON(Err_Precision)) {
+    IRExpr* nz = bAnd(sb, bNot(sb, isZero(sb, a)), bNot(sb, isZero(sb, b)));
+    IRExpr* eq = bOr(sb, cmpIs(sb, r, a, Ircr_EQ), cmpIs(sb, r, b, Ircr_EQ));
+    count_bit(sb, bAnd(sb, nz, eq), Err_Precision, ic);
+  }
+  if (cls == FP_Div && OA_KIND_ON(Err_DivByZero))
+    count_bit(sb, isZero(sb, b), Err_DivByZero, ic);
+  if (OA_KIND_ON(Err_Infinity)) {
+    IRExpr* p = bAnd(sb, isInf(sb, r),
+                    bNot(sb, bOr(sb, isInf(sb, a), isInf(sb, b))));
+    if (cls == FP_Div)
+      p = bAnd(sb, p, bNot(sb, isZero(sb, b)));  // already a division by zero
+    count_bit(sb, p, Err_Infinity, ic);
+  }
+  if (OA_KIND_ON(Err_NaN)) {
+    IRExpr* p = bAnd(sb, isNaN(sb, r),
+                    bNot(sb, bOr(sb, isNaN(sb, a), isNaN(sb, b))));
+    count_bit(sb, p, Err_NaN, ic);
+  }
+  if (cls != FP_AddSub && OA_KIND_ON(Err_Underflow)) {
+    IRExpr* p = bAnd(sb, isZero(sb, r),
+                    bNot(sb, bOr(sb, isZero(sb, a), isZero(sb, b))));
+    count_bit(sb, p, Err_Underflow, ic);
+  }
+}
+
+static FPClass fpClass(IROp op) {
+  switch(op) {
+    case Iop_MulF64: case Iop_MulF32: case Iop_Mul64F0x2: case Iop_Mul64Fx2:
+    case Iop_Mul32F0x4:
+      return FP_Mul;
+    case Iop_DivF64: case Iop_DivF32: case Iop_Div64F0x2: case Iop_Div64Fx2:
+    case Iop_Div32F0x4:
+      return FP_Div;
+    default:
+      return FP_AddSub;
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Subnormals                                                   ---*/
+/*--------------------------------------------------------------------*/
+
+#define F64_MIN_NORMAL 0x0010000000000000ULL  // 2^-1022
+#define F32_MIN_NORMAL 0x3810000000000000ULL  // 2^-126, as a double
+
+// 0 < |x| < the smallest normal number
+static IRExpr* isSubnormal(IRSB* sb, IRExpr* x, ULong minNormal) {
+  IRExpr* abs = OA_(newTmp)(sb, Ity_F64, IRExpr_Unop(Iop_AbsF64, x));
+  return bAnd(sb, cmpIs(sb, abs, IRExpr_Const(IRConst_F64i(minNormal)), Ircr_LT),
+              bNot(sb, isZero(sb, x)));
+}
+
+static IRExpr* anySubnormal(IRSB* sb, IRExpr* a, IRExpr* b, IRExpr* r,
+                            ULong minNormal) {
+  IRExpr* p = bOr(sb, isSubnormal(sb, a, minNormal), isSubnormal(sb, r, minNormal));
+  if (b != NULL)
+    p = bOr(sb, p, isSubnormal(sb, b, minNormal));
+  return p;
+}
+
+Bool OA_(subnormal_watched)(IROp op) {
+  switch(op) {
+    case Iop_AddF64: case Iop_SubF64: case Iop_MulF64: case Iop_DivF64:
+    case Iop_AddF32: case Iop_SubF32: case Iop_MulF32: case Iop_DivF32:
+    case Iop_Add64Fx2: case Iop_Sub64Fx2: case Iop_Mul64Fx2: case Iop_Div64Fx2:
+    case Iop_Add64F0x2: case Iop_Sub64F0x2: case Iop_Mul64F0x2: case Iop_Div64F0x2:
+    case Iop_Add32F0x4: case Iop_Sub32F0x4: case Iop_Mul32F0x4: case Iop_Div32F0x4:
+    case Iop_Add32Fx4: case Iop_Sub32Fx4: case Iop_Mul32Fx4: case Iop_Div32Fx4:
+    case Iop_Sqrt64Fx2: case Iop_Sqrt64F0x2: case Iop_Sqrt32Fx4: case Iop_Sqrt32F0x4:
+    case Iop_F64toF32:
+      return True;
+    default:
+      return False;
+  }
+}
+
+/* Counts the executions of the (already added) statement st that have a
+ * subnormal operand or result, in any lane */
+void OA_(count_subnormals)(IRSB* sb, IRStmt* st, OA_InstrumentContext ic) {
+  IRExpr* e = st->Ist.WrTmp.data;
+  IRExpr* r = IRExpr_RdTmp(st->Ist.WrTmp.tmp);
+  IRExpr* p;
+  IRExpr *a, *b;
+  Int i;
+  switch(ic->op) {
+    case Iop_AddF64: case Iop_SubF64: case Iop_MulF64: case Iop_DivF64:
+      p = anySubnormal(sb, e->Iex.Triop.details->arg2, e->Iex.Triop.details->arg3,
+                       r, F64_MIN_NORMAL);
+      break;
+    case Iop_AddF32: case Iop_SubF32: case Iop_MulF32: case Iop_DivF32:
+      p = anySubnormal(sb, OA_(toF64)(sb, e->Iex.Triop.details->arg2),
+                       OA_(toF64)(sb, e->Iex.Triop.details->arg3),
+                       OA_(toF64)(sb, r), F32_MIN_NORMAL);
+      break;
+    case Iop_Add64Fx2: case Iop_Sub64Fx2: case Iop_Mul64Fx2: case Iop_Div64Fx2:
+      a = e->Iex.Binop.arg1;
+      b = e->Iex.Binop.arg2;
+      p = bOr(sb, anySubnormal(sb, OA_(laneF64)(sb, a, 0), OA_(laneF64)(sb, b, 0),
+                               OA_(laneF64)(sb, r, 0), F64_MIN_NORMAL),
+                  anySubnormal(sb, OA_(laneF64)(sb, a, 1), OA_(laneF64)(sb, b, 1),
+                               OA_(laneF64)(sb, r, 1), F64_MIN_NORMAL));
+      break;
+    case Iop_Add64F0x2: case Iop_Sub64F0x2: case Iop_Mul64F0x2: case Iop_Div64F0x2:
+      p = anySubnormal(sb, OA_(laneF64)(sb, e->Iex.Binop.arg1, 0),
+                       OA_(laneF64)(sb, e->Iex.Binop.arg2, 0),
+                       OA_(laneF64)(sb, r, 0), F64_MIN_NORMAL);
+      break;
+    case Iop_Add32F0x4: case Iop_Sub32F0x4: case Iop_Mul32F0x4: case Iop_Div32F0x4:
+      p = anySubnormal(sb, OA_(lane0F32)(sb, e->Iex.Binop.arg1),
+                       OA_(lane0F32)(sb, e->Iex.Binop.arg2),
+                       OA_(lane0F32)(sb, r), F32_MIN_NORMAL);
+      break;
+    case Iop_Add32Fx4: case Iop_Sub32Fx4: case Iop_Mul32Fx4: case Iop_Div32Fx4:
+    case Iop_Sqrt32Fx4:
+      a = ic->op == Iop_Sqrt32Fx4 ? e->Iex.Unop.arg : e->Iex.Binop.arg1;
+      b = ic->op == Iop_Sqrt32Fx4 ? NULL : e->Iex.Binop.arg2;
+      p = NULL;
+      for (i = 0; i < 4; i++) {
+        IRExpr* q = anySubnormal(sb, OA_(laneF32)(sb, a, i),
+                                 b == NULL ? NULL : OA_(laneF32)(sb, b, i),
+                                 OA_(laneF32)(sb, r, i), F32_MIN_NORMAL);
+        p = p == NULL ? q : bOr(sb, p, q);
+      }
+      break;
+    case Iop_Sqrt32F0x4:
+      p = anySubnormal(sb, OA_(lane0F32)(sb, e->Iex.Unop.arg), NULL,
+                       OA_(lane0F32)(sb, r), F32_MIN_NORMAL);
+      break;
+    case Iop_Sqrt64Fx2:
+      a = e->Iex.Unop.arg;
+      p = bOr(sb, anySubnormal(sb, OA_(laneF64)(sb, a, 0), NULL,
+                               OA_(laneF64)(sb, r, 0), F64_MIN_NORMAL),
+                  anySubnormal(sb, OA_(laneF64)(sb, a, 1), NULL,
+                               OA_(laneF64)(sb, r, 1), F64_MIN_NORMAL));
+      break;
+    case Iop_Sqrt64F0x2:
+      p = anySubnormal(sb, OA_(laneF64)(sb, e->Iex.Unop.arg, 0), NULL,
+                       OA_(laneF64)(sb, r, 0), F64_MIN_NORMAL);
+      break;
+    case Iop_F64toF32:
+      // a subnormal double, or a double that only fits as a subnormal float
+      p = bOr(sb, isSubnormal(sb, e->Iex.Binop.arg2, F64_MIN_NORMAL),
+                  isSubnormal(sb, OA_(toF64)(sb, r), F32_MIN_NORMAL));
+      break;
+    default:
+      return;
+  }
+  count_bit(sb, p, Err_Subnormal, ic);
+}
+
+/*--------------------------------------------------------------------*/
+/* Adds the predicates of the (already added) statement st. Returns False
+ * if its operation has none */
+Bool OA_(count_result)(IRSB* sb, IRStmt* st, OA_InstrumentContext ic, IRType hWordTy) {
+  IRExpr* e = st->Ist.WrTmp.data;
+  IRExpr* r = IRExpr_RdTmp(st->Ist.WrTmp.tmp);
+  IRExpr *a, *b;
+  IROp op = ic->op;
+  switch(op) {
+    case Iop_Add32: case Iop_Sub32: case Iop_Add64: case Iop_Sub64:
+      if (OA_KIND_ON(Err_Overflow))
+        count_bit(sb, addSubOverflow(sb, op, e->Iex.Binop.arg1, e->Iex.Binop.arg2, r),
+                  Err_Overflow, ic);
+      break;
+    case Iop_Add16: case Iop_Sub16: case Iop_Mul16:
+      if (OA_KIND_ON(Err_Overflow))
+        count_bit(sb, i16Overflow(sb, op, e->Iex.Binop.arg1, e->Iex.Binop.arg2, r),
+                  Err_Overflow, ic);
+      break;
+    case Iop_Mul32: case Iop_Mul64:
+      if (op == Iop_Mul64 && hWordTy != Ity_I64) return False;  // no MullU64 on x86
+      if (OA_KIND_ON(Err_Overflow))
+        count_bit(sb, mulOverflow(sb, op, e->Iex.Binop.arg1, e->Iex.Binop.arg2),
+                  Err_Overflow, ic);
+      break;
+    case Iop_AddF64: case Iop_SubF64: case Iop_MulF64: case Iop_DivF64:
+      count_fp(sb, fpClass(op), e->Iex.Triop.details->arg2,
+               e->Iex.Triop.details->arg3, r, ic);
+      break;
+    case Iop_AddF32: case Iop_SubF32: case Iop_MulF32: case Iop_DivF32:
+      count_fp(sb, fpClass(op), OA_(toF64)(sb, e->Iex.Triop.details->arg2),
+               OA_(toF64)(sb, e->Iex.Triop.details->arg3),
+               OA_(toF64)(sb, r), ic);
+      break;
+    case Iop_Add64Fx2: case Iop_Sub64Fx2: case Iop_Mul64Fx2: case Iop_Div64Fx2:
+      count_fp(sb, fpClass(op), OA_(laneF64)(sb, e->Iex.Binop.arg1, 1),
+               OA_(laneF64)(sb, e->Iex.Binop.arg2, 1), OA_(laneF64)(sb, r, 1), ic);
+      // fall through, for the low lane
+    case Iop_Add64F0x2: case Iop_Sub64F0x2: case Iop_Mul64F0x2: case Iop_Div64F0x2:
+      count_fp(sb, fpClass(op), OA_(laneF64)(sb, e->Iex.Binop.arg1, 0),
+               OA_(laneF64)(sb, e->Iex.Binop.arg2, 0), OA_(laneF64)(sb, r, 0), ic);
+      break;
+    case Iop_Add32F0x4: case Iop_Sub32F0x4: case Iop_Mul32F0x4: case Iop_Div32F0x4:
+      count_fp(sb, fpClass(op), OA_(lane0F32)(sb, e->Iex.Binop.arg1),
+               OA_(lane0F32)(sb, e->Iex.Binop.arg2), OA_(lane0F32)(sb, r), ic);
+      break;
+    case Iop_CmpF64: case Iop_CmpF32:
+      // comparing with NaN is always false, as check_CmpF64
+      if (!OA_KIND_ON(Err_NaN)) break;
+      a = e->Iex.Binop.arg1;
+      b = e->Iex.Binop.arg2;
+      if (op == Iop_CmpF32) {  // widened, exactly, to F64
+        a = OA_(toF64)(sb, a);
+        b = OA_(toF64)(sb, b);
+      }
+      count_bit(sb, bOr(sb, isNaN(sb, a), isNaN(sb, b)), Err_NaN, ic);
+      break;
+    case Iop_F64toF32:
+      a = e->Iex.Binop.arg2;
+      r = OA_(toF64)(sb, r);
+      if (OA_KIND_ON(Err_Overflow))
+        count_bit(sb, bAnd(sb, isInf(sb, r), bNot(sb, isInf(sb, a))), Err_Overflow, ic);
+      if (OA_KIND_ON(Err_Underflow))
+        count_bit(sb, bAnd(sb, isZero(sb, r), bNot(sb, isZero(sb, a))), Err_Underflow, ic);
+      break;
+    case Iop_Sqrt64Fx2:
+      if (!OA_KIND_ON(Err_NaN)) break;
+      a = OA_(laneF64)(sb, e->Iex.Unop.arg, 0);
+      count_bit(sb, bAnd(sb, isNaN(sb, OA_(laneF64)(sb, r, 0)), bNot(sb, isNaN(sb, a))), Err_NaN, ic);
+      a = OA_(laneF64)(sb, e->Iex.Unop.arg, 1);
+      count_bit(sb, bAnd(sb, isNaN(sb, OA_(laneF64)(sb, r, 1)), bNot(sb, isNaN(sb, a))), Err_NaN, ic);
+      break;
+    default:
+      return False;  // packed compares, AVX: not counted
+  }
+  return True;
+}
+
+/* --hot-tier=guard: the predicates of st, and'ed with guard, guard
+ * reports. Returns False if its operation has none */
+Bool OA_(guard_result)(IRSB* sb, IRStmt* st, OA_InstrumentContext ic, IRType hWordTy,
+                       IRExpr* guard) {
+  Bool done;
+  reporting   = True;
+  reportGuard = guard;
+  done = OA_(count_result)(sb, st, ic, hWordTy);
+  reporting   = False;
+  reportGuard = NULL;
+  return done;
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
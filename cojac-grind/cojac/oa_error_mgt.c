@@ -38,14 +38,15 @@
 #include "pub_tool_mallocfree.h"
 #include "pub_tool_threadstate.h"
 #include "pub_tool_stacktrace.h"
+#include "pub_tool_execontext.h"
 #include <limits.h>
 #include <inttypes.h>
 
 /*--------------------------------------------------------------------*/
 static ULong nErrors=0L;
-static const ULong nErrorsMax=1000000L;  // after that, no more malloc in errors
+static const ULong nErrorsMax=1000000L;  // a message every 10 times that
 /*--------------------------------------------------------------------*/
-static const char * strFromErrorKind(ErrorKind errKind) {
+const HChar* OA_(strFromErrorKind)(ErrorKind errKind) {
   switch(errKind) {
     case Err_Overflow:        return "Overflow";
     case Err_Cast:            return "Cast";
@@ -57,6 +58,7 @@ static const char * strFromErrorKind(ErrorKind errKind) {
     case Err_DivByZero:       return "DivByZero";
     case Err_Underflow:       return "Underflow";
     case Err_CloseComparison: return "CloseComparison";
+    case Err_Subnormal:       return "Subnormal";
     default:                  return "Unknown error kind...";
     //VG_(message)(Vg_UserMsg, "strFromErrorKind %d ", errKind);
   }
@@ -65,22 +67,79 @@ static const char * strFromErrorKind(ErrorKind errKind) {
 /*--------------------------------------------------------------------*/
 static void oa_maybe_error_extra(ErrorKind ekind, Char* s, Addr addr, void* extra)  {
   ThreadId tid=VG_(get_running_tid)();
+  ULong t0 = OA_(stats_enter)(OA_TimeRecordError);
   VG_(maybe_record_error)(tid, ekind, addr, s, extra);
+  OA_(stats_leave)(OA_TimeRecordError, t0);
 }
-void OA_(maybe_error)(ErrorKind ekind, OA_InstrumentContext inscon)  {
+static Int depthOf(OA_ICType type) {
+  switch(type){
+    case IsCall: return OA_(options).stacktraceCallDepth;
+    case IsIROp: return OA_(options).stacktraceDepth;
+    default:     return 1;
+  }
+}
+
+/* The extra lives on the stack of maybe_error: the core copies it (see
+ * OA_(update_Error_extra)) only when it keeps the error, so recording an
+ * error allocates nothing */
+static void fill_extra(cojacErrorExtra extra, OA_InstrumentContext inscon,
+                       Bool first) {
+  extra->tid=VG_(get_running_tid)();
+  extra->type = inscon->type;
+  extra->operands[0] = '\0';
+  // the frame of the operation is live: its locals can be described
+  if (first && OA_(options).describeOperands)
+    OA_(operands_describe)(inscon, extra->operands, sizeof(extra->operands));
+}
+
+/* --call-contexts: reported once per calling context, with the stack of
+ * the shadow call stack; the core neither unwinds nor keeps the error */
+static void error_in_context(ErrorKind ekind, OA_InstrumentContext inscon) {
+  cojacErrorExtra_ extra;
+  ThreadId tid;
+  ExeContext* where;
+  ULong t0;
+  if (!OA_(callctx_first)(inscon->addr, ekind)) return;
+  fill_extra(&extra, inscon, True);
+  tid = VG_(get_running_tid)();
+  where = OA_(callctx_where)(inscon->addr, depthOf(inscon->type));
+  t0 = OA_(stats_enter)(OA_TimeRecordError);
+  VG_(unique_error)(tid, ekind, inscon->addr, inscon->string, &extra,
+                    where, True/*print*/, True/*GDB*/, True/*count*/);
+  OA_(stats_leave)(OA_TimeRecordError, t0);
+}
+
+static void maybe_error(ErrorKind ekind, OA_InstrumentContext inscon)  {
   // it would be possible to move this computation here:
   //get_debug_info((Addr)(inscon->addr), filename, fctname, &line);
-  Char thisFct[]="maybe_error";
-  cojacErrorExtra extra=NULL;
+  cojacErrorExtra_ extra;
+  OA_Site* site;
+  Bool first=False;
+  if (!OA_KIND_ON(ekind)) return;
+  site=OA_(site_hit)(inscon, ekind);
+  if (!site->reported) {
+    // with --max-sites, a site that inherited the count of an evicted one
+    // must earn its place before it is passed to the core
+    if (site->err > 0 && site->count - site->err < 2) return;
+    site->reported = True;
+    first = True;
+  }
 	nErrors++;
-	if (nErrors<nErrorsMax) {
-    extra=VG_(malloc)(thisFct, sizeof(cojacErrorExtra_));
-    extra->tid=VG_(get_running_tid)();
-    extra->type = inscon->type;
-  } else if (nErrors%(10L*nErrorsMax)==0) {
+  if (OA_(options).callContexts) {
+    error_in_context(ekind, inscon);  // the repetitions are in the site table
+    return;
+  }
+	if (nErrors%(10L*nErrorsMax)==0) {
   	VG_(message)(Vg_UserMsg, "A lot of errors: %" PRIu64 "...\n", nErrors);
   }
-  oa_maybe_error_extra(ekind, inscon->string, inscon->addr, extra);
+  fill_extra(&extra, inscon, first);
+  oa_maybe_error_extra(ekind, inscon->string, inscon->addr, &extra);
+}
+
+void OA_(maybe_error)(ErrorKind ekind, OA_InstrumentContext inscon)  {
+  ULong t0 = OA_(stats_enter)(OA_TimeMaybeError);
+  maybe_error(ekind, inscon);
+  OA_(stats_leave)(OA_TimeMaybeError, t0);
 }
 
 /*--------------------------------------------------------------------*/
@@ -92,35 +151,65 @@ Bool OA_(eq_Error) (VgRes res, Error* e1, Error* e2) {
   ErrorKind k2 = VG_(get_error_kind)(e2);
   Addr addr1  =  VG_(get_error_address)(e1);
   Addr addr2  =  VG_(get_error_address)(e2);
-  if (addr1 != (Addr)NULL && addr1==addr2  && k1==k2)
-    return True;
-  return False;
+  if (addr1 == (Addr)NULL || addr1!=addr2  || k1!=k2)
+    return False;
+  // --call-contexts: the same site in another context is another error
+  if (OA_(options).callContexts)
+    return VG_(eq_ExeContext)(Vg_HighRes, VG_(get_error_where)(e1),
+                              VG_(get_error_where)(e2));
+  return True;
   //Char * msg1  = VG_(get_error_string) (e1);
   //Char * msg2  = VG_(get_error_string) (e2);
   //if (VG_STREQ(msg1, msg2)) ...
 }
 
+/* Consistent with OA_(eq_Error): the core indexes the errors with it */
+UWord OA_(hash_Error) ( Error* err ) {
+  return (UWord)VG_(get_error_address)(err) ^ (UWord)VG_(get_error_kind)(err);
+}
+
 void OA_(before_pp_Error) ( Error* err ) { }
 
+/* The first depth entries of the stack recorded with the error */
+#define OA_PP_DEPTH_MAX 500   // the deepest backtrace of the core
+static Addr ppIps[OA_PP_DEPTH_MAX];
+static UInt ppN;
+
+static void keep_ip(UInt n, Addr ip) {
+  ppIps[n] = ip;
+  ppN = n+1;
+}
+
+static void pp_where(ExeContext* where, Int depth) {
+  Int n = VG_(get_ExeContext_n_ips)(where);
+  if (n > depth)           n = depth;
+  if (n > OA_PP_DEPTH_MAX) n = OA_PP_DEPTH_MAX;
+  ppN = 0;
+  VG_(apply_ExeContext)(keep_ip, where, n);
+  VG_(pp_StackTrace)(ppIps, ppN);
+}
+
 void OA_(pp_Error) ( Error* err ) {
   Char *detail=VG_(get_error_string)(err);
   if (detail==NULL) detail="";
   ErrorKind errKind = VG_(get_error_kind)(err);
-  VG_(message)(Vg_UserMsg, "Cojac: %s, %s", strFromErrorKind(errKind), detail);
+  VG_(message)(Vg_UserMsg, "Cojac: %s, %s", OA_(strFromErrorKind)(errKind), detail);
   cojacErrorExtra extra = (cojacErrorExtra)( VG_(get_error_extra)(err) );
   Int depth;
-  switch(extra->type){
-    case IsCall: depth=OA_(options).stacktraceCallDepth; break;
-    case IsIROp: depth=OA_(options).stacktraceDepth; break;
-    default: depth=1; break;
-  }
-  if (depth==0 || extra==NULL) return;
-  VG_(get_and_pp_StackTrace)(extra->tid, depth);  // This stupidly adds an extra newline...
-  VG_(free)(extra);
+  if (extra==NULL) return;
+  depth = depthOf(extra->type);
+  if (depth>0)
+    pp_where(VG_(get_error_where)(err), depth);  // the shadow stack with --call-contexts
+  if (extra->operands[0] != '\0')
+    VG_(message)(Vg_UserMsg, "%s", extra->operands);
 }
 
+/* The error is new: the core copies its extra, the size is returned */
 UInt OA_(update_Error_extra) ( Error* err ) {
-  return 0;
+  if (VG_(get_error_extra)(err) == NULL) return 0;
+  if (!OA_(options).callContexts)  // VG_(unique_error) does not copy
+    OA_(stats_extra_alloc)(sizeof(cojacErrorExtra_));
+  return sizeof(cojacErrorExtra_);
 }
 
 Bool OA_(is_recognised_suppression) ( const HChar* name, Supp* su ) {
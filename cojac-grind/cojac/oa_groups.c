@@ -0,0 +1,165 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.              oa_groups --*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+
+/* Per-translation groups of instrumentation data.
+ *
+ * Every OA_InstrumentContext (and every batch descriptor, with --batch)
+ * is only referenced by the code of the translation it was made for. So
+ * all of them are attached to a group, keyed by the address of the
+ * translation (closure->nraddr), and the group is released when the core
+ * discards that translation (transtab sector recycling, client requests,
+ * self-modifying or JIT code). The contexts then go to a free list that
+ * the next translations draw from; the other blocks are freed.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "pub_tool_hashtable.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_mallocfree.h"
+#include "pub_tool_xarray.h"
+#include "oa_include.h"
+
+/*--------------------------------------------------------------------*/
+typedef struct _OA_Group {
+  struct _OA_Group*    next;      // VgHashNode layout
+  UWord                key;       // nraddr of the translation
+  OA_InstrumentContext contexts;  // linked by nextInGroup
+  XArray*              owned;     // other blocks (void*), or NULL
+} OA_Group;
+
+static VgHashTable          groups  = NULL;
+static OA_Group*            curGroup = NULL;  // translation being made
+static OA_InstrumentContext pool    = NULL;   // free contexts
+
+static ULong nContexts = 0;   // allocated with malloc
+static ULong nRecycled = 0;   // taken from the pool
+
+/*--------------------------------------------------------------------*/
+void OA_(groups_init)(void) {
+  groups = VG_(HT_construct)("cojac.groups");
+}
+
+void OA_(group_begin)(Addr64 nraddr) {
+  HChar thisFct[]="group_begin";
+  tl_assert(curGroup == NULL);
+  curGroup = VG_(malloc)(thisFct, sizeof(OA_Group));
+  curGroup->key      = (UWord)nraddr;
+  curGroup->contexts = NULL;
+  curGroup->owned    = NULL;
+}
+
+static void release_group(OA_Group* g) {
+  Word i;
+  while (g->contexts != NULL) {
+    OA_InstrumentContext ic = g->contexts;
+    g->contexts = ic->nextInGroup;
+    ic->nextInGroup = pool;
+    pool = ic;
+  }
+  if (g->owned != NULL) {
+    for (i=0; i<VG_(sizeXA)(g->owned); i++)
+      VG_(free)(*(void**)VG_(indexXA)(g->owned, i));
+    VG_(deleteXA)(g->owned);
+  }
+  VG_(free)(g);
+}
+
+void OA_(group_end)(void) {
+  OA_Group* old;
+  tl_assert(curGroup != NULL);
+  if (curGroup->contexts == NULL && curGroup->owned == NULL) {
+    VG_(free)(curGroup);   // nothing instrumented
+  } else {
+    // should not happen, but a stale group must not outlive its key
+    old = VG_(HT_remove)(groups, curGroup->key);
+    if (old != NULL) release_group(old);
+    VG_(HT_add_node)(groups, curGroup);
+  }
+  curGroup = NULL;
+}
+
+/*--------------------------------------------------------------------*/
+OA_InstrumentContext OA_(new_context)(void) {
+  HChar thisFct[]="new_context";
+  OA_InstrumentContext ic;
+  tl_assert(curGroup != NULL);
+  if (pool != NULL) {
+    ic = pool;
+    pool = ic->nextInGroup;
+    nRecycled++;
+  } else {
+    ic = VG_(malloc)(thisFct, sizeof(OA_InstrumentContext_));
+    nContexts++;
+  }
+  ic->nextInGroup = curGroup->contexts;
+  curGroup->contexts = ic;
+  return ic;
+}
+
+/* Gives back the last context obtained, when it is not used after all */
+void OA_(drop_context)(OA_InstrumentContext ic) {
+  tl_assert(curGroup != NULL && curGroup->contexts == ic);
+  curGroup->contexts = ic->nextInGroup;
+  ic->nextInGroup = pool;
+  pool = ic;
+}
+
+/* The block (from VG_(malloc)) will be freed with the translation */
+void OA_(group_own)(void* block) {
+  tl_assert(curGroup != NULL);
+  if (curGroup->owned == NULL)
+    curGroup->owned = VG_(newXA)(VG_(malloc), "cojac.group.owned",
+                                 VG_(free), sizeof(void*));
+  VG_(addToXA)(curGroup->owned, &block);
+}
+
+/*--------------------------------------------------------------------*/
+void OA_(discard_superblock_info)(Addr64 orig_addr, VexGuestExtents vge) {
+  OA_Group* g = VG_(HT_remove)(groups, (UWord)orig_addr);
+  if (g != NULL)
+    release_group(g);
+}
+
+/* The contexts are never freed, those of the discarded translations are
+ * kept in the pool */
+ULong OA_(groups_context_bytes)(void) {
+  return nContexts * sizeof(OA_InstrumentContext_);
+}
+
+void OA_(groups_print_stats)(void) {
+  VG_(umsg)("    contexts: %llu allocated, %llu recycled, %d live translations\n",
+            nContexts, nRecycled, VG_(HT_count_nodes)(groups));
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,124 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.            oa_helpers ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* Helpers shared by the inline instrumentation (oa_count.c, oa_range.c,
+ * oa_convert.c, oa_waste.c, ...) and by the end-of-run reports. The IR
+ * they build is flat: every intermediate value gets its own temporary.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcbase.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_debuginfo.h"
+#include "oa_include.h"
+
+/*--------------------------------------------------------------------*/
+/*--- IR                                                           ---*/
+/*--------------------------------------------------------------------*/
+/* A new temporary, set to e */
+IRExpr* OA_(newTmp)(IRSB* sb, IRType ty, IRExpr* e) {
+  IRTemp t = newIRTemp(sb->tyenv, ty);
+  addStmtToIRSB(sb, IRStmt_WrTmp(t, e));
+  return IRExpr_RdTmp(t);
+}
+
+/* An F32, widened (exactly) to F64 */
+IRExpr* OA_(toF64)(IRSB* sb, IRExpr* e) {
+  return OA_(newTmp)(sb, Ity_F64, IRExpr_Unop(Iop_F32toF64, e));
+}
+
+/* The F64 lane 0 or 1 of a V128 */
+IRExpr* OA_(laneF64)(IRSB* sb, IRExpr* v, Int lane) {
+  IRExpr* i = OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(lane == 0 ? Iop_V128to64
+                                                             : Iop_V128HIto64, v));
+  return OA_(newTmp)(sb, Ity_F64, IRExpr_Unop(Iop_ReinterpI64asF64, i));
+}
+
+/* The F32 lane 0 of a V128, widened to F64 */
+IRExpr* OA_(lane0F32)(IRSB* sb, IRExpr* v) {
+  IRExpr* i = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_V128to32, v));
+  IRExpr* f = OA_(newTmp)(sb, Ity_F32, IRExpr_Unop(Iop_ReinterpI32asF32, i));
+  return OA_(toF64)(sb, f);
+}
+
+/* The F32 lane (0 to 3) of a V128, widened to F64 */
+IRExpr* OA_(laneF32)(IRSB* sb, IRExpr* v, Int lane) {
+  IRExpr* h = OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(lane < 2 ? Iop_V128to64
+                                                            : Iop_V128HIto64, v));
+  IRExpr* i = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(lane % 2 == 0 ? Iop_64to32
+                                                                 : Iop_64HIto32, h));
+  IRExpr* f = OA_(newTmp)(sb, Ity_F32, IRExpr_Unop(Iop_ReinterpI32asF32, i));
+  return OA_(toF64)(sb, f);
+}
+
+/* The ULong at addr is incremented by inc (an I64) */
+void OA_(add_at)(IRSB* sb, IRExpr* addr, IRExpr* inc) {
+  IRExpr* old = OA_(newTmp)(sb, Ity_I64, IRExpr_Load(Iend_LE, Ity_I64, addr));
+  IRExpr* sum = OA_(newTmp)(sb, Ity_I64, IRExpr_Binop(Iop_Add64, old, inc));
+  addStmtToIRSB(sb, IRStmt_Store(Iend_LE, addr, sum));
+}
+
+/* *counter += inc (an I64) */
+void OA_(add_to)(IRSB* sb, ULong* counter, IRExpr* inc) {
+  OA_(add_at)(sb, mkIRExpr_HWord((HWord)counter), inc);
+}
+
+/* *counter += b, b being an I32 0/1 */
+void OA_(add_bit)(IRSB* sb, ULong* counter, IRExpr* b) {
+  OA_(add_to)(sb, counter, OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(Iop_32Uto64, b)));
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Reports                                                      ---*/
+/*--------------------------------------------------------------------*/
+/* The function, file and line of a code address, "???" (line 0) when
+ * the debug info does not have them */
+void OA_(site_location)(Addr a, HChar fn[COJAC_FCT_LEN],
+                        HChar file[COJAC_FILE_LEN], UInt* line) {
+  HChar dir[COJAC_FILE_LEN];
+  Bool  hasDir;
+  *line = 0;
+  if (!VG_(get_fnname)(a, fn, COJAC_FCT_LEN))
+    VG_(strcpy)(fn, "???");
+  if (!VG_(get_filename_linenum)(a, file, COJAC_FILE_LEN, dir, sizeof(dir),
+                                 &hasDir, line))
+    VG_(strcpy)(file, "???");
+}
+
+/* "12.5%", without the padding of VG_(percentify); buf has 8 chars */
+const HChar* OA_(percent)(ULong n, ULong m, HChar buf[]) {
+  VG_(percentify)(n, m, 1, 7, buf);
+  while (*buf == ' ') buf++;
+  return buf;
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
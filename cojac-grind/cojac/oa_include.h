@@ -48,9 +48,18 @@ typedef enum {
 	Err_Math,
 	Err_DivByZero,
 	Err_Underflow,
-	Err_CloseComparison
+	Err_CloseComparison,
+	Err_Subnormal       // a performance event, counted per site only
 } OA_ErrorTag;
 
+#define OA_NoError (-1)  // returned by the diag_* functions
+
+/* Set of error kinds, as selected by --kinds=... ("all" is the numerical
+ * errors, Err_Subnormal is only on when asked for) */
+#define OA_KIND_BIT(k)  (1U << (k))
+#define OA_ALL_KINDS    (OA_KIND_BIT(Err_CloseComparison+1)-1)
+#define OA_KIND_ON(k)   ((OA_(options).kinds & OA_KIND_BIT(k)) != 0)
+
 /* Function calls to be instrumented.
 The instrumentation is done by watching for "bad" inputs.
 See man page of each function to understand how it works.*/
@@ -83,17 +92,25 @@ typedef enum {
 #define COJAC_FILE_LEN  1024
 #define COJAC_FCT_LEN   50
 
-typedef struct {
+typedef struct _OA_InstrumentContext_ {
 	Addr  addr;
 	OA_ICType type;
 	IROp  op;
 	OA_Call call;
 	Bool  isLocated;
 	HChar* string;
+	struct _OA_InstrumentContext_* nextInGroup;  // see oa_groups.c
 } OA_InstrumentContext_;
 
 typedef OA_InstrumentContext_*  OA_InstrumentContext;
 
+/* What the hot superblocks are translated again with (--hot-tier) */
+typedef enum {
+  OA_HotNone,    // no tiers: always the exact checks
+  OA_HotGuard,   // inline predicates, each guarding a report
+  OA_HotSample   // the exact checks, one execution in OA_HOT_SAMPLE
+} OA_HotTier;
+
 typedef struct {
   Int  stacktraceDepth;
   Int  stacktraceCallDepth;
@@ -104,15 +121,37 @@ typedef struct {
   Bool i16;
   Bool i64;
   Bool mathOp;
+  Bool castToI32;
   Bool castToI16;
+  Bool castToI8;
   Bool castFromF64;
+  Bool batch;
+  Bool fusedOps;
+  UInt kinds;      // OA_KIND_BIT() set of the error kinds to look for
+  const HChar* watchUnder;  // function name pattern, or NULL
+  const HChar* reportFile;  // compact site report, or NULL
+  Int  maxSites;   // bound of the site table, 0 if none
+  Bool countOnly;  // --mode=count: inline counters, no error reported
+  Bool rangeProfile;  // exponent histograms of the F64 sites
+  Bool convertProfile;  // executions of the F32/F64/int conversions
+  Bool wastedWork;      // FP ops with no effect, or on NaN/Inf
+  Bool cojacStats;      // overhead self-profiling
+  const HChar* siteCache;  // directory of the on-disk site cache, or NULL
+  Bool deferredSymbols; // --symbolize=deferred: located per object
+  Bool describeOperands;  // names of the variables read, from var info
+  Bool callContexts;      // shadow call stack, errors per calling context
+  OA_HotTier hotTier;     // cheaper checks for the hot superblocks
+  Int  hotAfter;          // executions before a superblock is hot
   Double Ulp_factor_f64;
   Double Ulp_factor_f32;
 } cojacOptions;
 
+#define OA_OPERANDS_LEN 256
+
 typedef struct {
   Int tid;
   OA_ICType type;
+  HChar operands[OA_OPERANDS_LEN];  // --describe-operands, or ""
 } cojacErrorExtra_;
 
 typedef cojacErrorExtra_* cojacErrorExtra;
@@ -122,6 +161,7 @@ typedef struct {
   const HChar* name;
   void*       callbackI32;  // for x86   arch
   void*       callbackI64;  // for amd64 arch
+  void*       fusedI64;     // computes one lane + diagnosis (amd64, --fusedOps)
   Long        occurrences;
 } Iop_Cojac_attributes;
 
@@ -157,23 +197,19 @@ Iop_Cojac_attributes* OA_(get_Iop_struct)(IROp op);
  */
  //x86
 VG_REGPARM(3) void oa_callbackI32_2x32 ( Int a,  Int b, OA_InstrumentContext c);
-VG_REGPARM(2) void oa_callbackI32_1x32 ( Int a,         OA_InstrumentContext c);
 VG_REGPARM(3) void oa_callbackI32_2x16 ( Int a,  Int b, OA_InstrumentContext c);
 VG_REGPARM(3) void oa_callbackI32_2x64 (UInt a, UInt b, OA_InstrumentContext c);
-VG_REGPARM(2) void oa_callbackI32_1x64 (UInt a,         OA_InstrumentContext c);
 
 VG_REGPARM(3) void oa_callbackI32_2xF32(UInt a, UInt b, OA_InstrumentContext ic);
 VG_REGPARM(4) void oa_callbackI32_2xF64(UInt a, UInt b, OA_InstrumentContext ic);
-VG_REGPARM(3) void oa_callbackI32_1xI32_1xF64(UInt roundingMode, UInt la, OA_InstrumentContext ic);
+void oa_callbackI32_1xI32_1xF64(UInt roundingMode, UInt hi, UInt lo, OA_InstrumentContext ic);
 VG_REGPARM(2) void oa_callbackI32_1xF64(UInt a, OA_InstrumentContext ic);
 VG_REGPARM(2) void oa_callbackI32_call_1xF64(UInt a, OA_InstrumentContext ic);
 VG_REGPARM(2) void oa_callbackI32_call_1xF32(UInt a, OA_InstrumentContext ic);
 
 //amd64
 VG_REGPARM(3) void oa_callbackI64_2x32 (ULong a, ULong b, OA_InstrumentContext c);
-VG_REGPARM(2) void oa_callbackI64_1x32 (ULong a,          OA_InstrumentContext c);
 VG_REGPARM(3) void oa_callbackI64_2x64 ( Long a,  Long b, OA_InstrumentContext c);
-VG_REGPARM(2) void oa_callbackI64_1x64 ( Long a,          OA_InstrumentContext c);
 VG_REGPARM(3) void oa_callbackI64_2x16 (ULong a, ULong b, OA_InstrumentContext c);
 
 VG_REGPARM(3) void oa_callbackI64_2xF32(ULong la, ULong lb, OA_InstrumentContext ic);
@@ -183,6 +219,212 @@ VG_REGPARM(3) void oa_callbackI64_2xF64( ULong la, ULong lb, OA_InstrumentContex
 VG_REGPARM(2) void oa_callbackI64_1xF64(ULong la, OA_InstrumentContext ic);
 VG_REGPARM(2) void oa_callbackI64_call_1xF64(ULong la, OA_InstrumentContext ic);
 VG_REGPARM(2) void oa_callbackI64_call_1xF32(ULong la, OA_InstrumentContext ic);
+VG_REGPARM(3) void oa_callbackI64_cmp64F(ULong la0, ULong la1, ULong lb0, ULong lb1, OA_InstrumentContext ic);
+VG_REGPARM(3) void oa_callbackI64_cmp32F(ULong la0, ULong la1, ULong lb0, ULong lb1, OA_InstrumentContext ic);
+
+// amd64, --fusedOps=yes: return the result, the diagnosis goes to OA_(fused_status)
+extern UInt OA_(fused_status);
+VG_REGPARM(2) ULong oa_fusedI64_DivF64(ULong la, ULong lb);
+VG_REGPARM(1) ULong oa_fusedI64_SqrtF64(ULong la);
+VG_REGPARM(1) void  oa_fused_report(OA_InstrumentContext ic);
+
+// integer divisions and narrowing casts: the checks are inline IR, the
+// guarded call only reports
+VG_REGPARM(2) void oa_inline_report(HWord kind, OA_InstrumentContext ic);
+
+/*------------------------------------------------------------*/
+/*--- Shared IR and report helpers (oa_helpers.c)          ---*/
+/*------------------------------------------------------------*/
+IRExpr*      OA_(newTmp)        ( IRSB* sb, IRType ty, IRExpr* e );
+IRExpr*      OA_(toF64)         ( IRSB* sb, IRExpr* f32 );
+IRExpr*      OA_(laneF64)       ( IRSB* sb, IRExpr* v, Int lane );
+IRExpr*      OA_(lane0F32)      ( IRSB* sb, IRExpr* v );
+IRExpr*      OA_(laneF32)       ( IRSB* sb, IRExpr* v, Int lane );
+void         OA_(add_at)        ( IRSB* sb, IRExpr* addr, IRExpr* inc );
+void         OA_(add_to)        ( IRSB* sb, ULong* counter, IRExpr* inc );
+void         OA_(add_bit)       ( IRSB* sb, ULong* counter, IRExpr* b );
+void         OA_(site_location) ( Addr a, HChar fn[COJAC_FCT_LEN],
+                                  HChar file[COJAC_FILE_LEN], UInt* line );
+const HChar* OA_(percent)       ( ULong n, ULong m, HChar buf[] );
+
+/*------------------------------------------------------------*/
+/*--- Batched checking (oa_batch.c)                        ---*/
+/*------------------------------------------------------------*/
+
+#define OA_BATCH_MAX 64   // watched ops checked by one flush call
+
+typedef struct _OA_BatchDesc* OA_BatchDesc;
+
+void OA_(batch_init)        ( void );
+void OA_(batch_begin_SB)    ( void );
+void OA_(batch_add_op)      ( IRSB* sb, IROp op, void* callback,
+                              IRExpr* arg1, IRExpr* arg2, OA_InstrumentContext ic );
+void OA_(batch_before_exit) ( IRSB* sb, IRExpr* guard );
+void OA_(batch_end_SB)      ( IRSB* sb );
+void OA_(batch_thread_switch) ( ThreadId tid );
+VG_REGPARM(2) void OA_(batch_flush) ( OA_BatchDesc d, HWord n );
+
+/*------------------------------------------------------------*/
+/*--- Dynamically scoped checking (oa_scope.c)             ---*/
+/*------------------------------------------------------------*/
+
+extern UInt OA_(scope_depth);
+
+Bool    OA_(scope_active)     ( void );
+void    OA_(scope_thread_switch) ( ThreadId tid );
+void    OA_(scope_begin_SB)   ( void );
+void    OA_(scope_at_IMark)   ( IRSB* sb, Addr64 cia, VexGuestLayout* layout,
+                                IRType gWordTy );
+IRExpr* OA_(scope_guard)      ( IRSB* sb );
+IRExpr* OA_(scope_and_guard)  ( IRSB* sb, IRExpr* g );
+void    OA_(scope_end_SB)     ( IRSB* sb, VexGuestLayout* layout, IRType gWordTy );
+VG_REGPARM(1) void OA_(scope_enter) ( HWord sp );
+VG_REGPARM(1) void OA_(scope_ret)   ( HWord sp );
+
+/*------------------------------------------------------------*/
+/*--- Calling contexts (oa_callctx.c)                      ---*/
+/*------------------------------------------------------------*/
+
+void        OA_(callctx_init)          ( void );
+void        OA_(callctx_thread_switch) ( ThreadId tid );
+void        OA_(callctx_end_SB)        ( IRSB* sb, Addr64 cia,
+                                         VexGuestLayout* layout, IRType gWordTy );
+Bool        OA_(callctx_first)         ( Addr site, ErrorKind kind );
+ExeContext* OA_(callctx_where)         ( Addr site, Int depth );
+
+/*------------------------------------------------------------*/
+/*--- Per-translation groups (oa_groups.c)                 ---*/
+/*------------------------------------------------------------*/
+
+void OA_(groups_init)       ( void );
+void OA_(group_begin)       ( Addr64 nraddr );
+void OA_(group_end)         ( void );
+OA_InstrumentContext OA_(new_context) ( void );
+void OA_(drop_context)      ( OA_InstrumentContext ic );
+void OA_(group_own)         ( void* block );
+void OA_(discard_superblock_info) ( Addr64 orig_addr, VexGuestExtents vge );
+void OA_(groups_print_stats) ( void );
+ULong OA_(groups_context_bytes) ( void );
+
+/*------------------------------------------------------------*/
+/*--- Site table (oa_sites.c)                              ---*/
+/*------------------------------------------------------------*/
+
+typedef struct _OA_Site {
+  struct _OA_Site* next;   // VgHashNode layout
+  UWord            key;
+  Addr             addr;
+  const HChar*     what;   // IROp or call name
+  ErrorKind        kind;
+  ULong            count;  // errors raised
+  ULong            err;    // count overestimation, with --max-sites
+  Int              heapIdx;
+  Bool             reported;  // already passed to the core
+} OA_Site;
+
+void     OA_(sites_init) ( void );
+void     OA_(sites_fini) ( void );
+void     OA_(sites_print_counts) ( void );
+void     OA_(sites_print_subnormals) ( void );
+OA_Site* OA_(site_hit)   ( OA_InstrumentContext ic, ErrorKind kind );
+ULong*   OA_(site_counter) ( OA_InstrumentContext ic, ErrorKind kind );
+Bool     OA_(site_reported) ( Addr addr );
+
+/*------------------------------------------------------------*/
+/*--- Counting mode (oa_count.c)                           ---*/
+/*------------------------------------------------------------*/
+
+void OA_(count_if)     ( IRSB* sb, IRExpr* guard, ErrorKind kind,
+                         OA_InstrumentContext ic );
+Bool OA_(count_result) ( IRSB* sb, IRStmt* st, OA_InstrumentContext ic,
+                         IRType hWordTy );
+Bool OA_(guard_result) ( IRSB* sb, IRStmt* st, OA_InstrumentContext ic,
+                         IRType hWordTy, IRExpr* guard );
+Bool OA_(subnormal_watched) ( IROp op );
+void OA_(count_subnormals)  ( IRSB* sb, IRStmt* st, OA_InstrumentContext ic );
+
+/*------------------------------------------------------------*/
+/*--- Tiered instrumentation (oa_tier.c)                   ---*/
+/*------------------------------------------------------------*/
+
+Bool    OA_(tiers_active)    ( void );
+void    OA_(tier_begin_SB)   ( void );
+IRExpr* OA_(tier_hot)        ( IRSB* sb );
+void    OA_(tier_predicated) ( Bool predicated );
+IRExpr* OA_(tier_guard)      ( IRSB* sb, OA_InstrumentContext ic );
+void    OA_(tier_print_stats) ( void );
+
+/*------------------------------------------------------------*/
+/*--- Dynamic range profile (oa_range.c)                   ---*/
+/*------------------------------------------------------------*/
+
+void OA_(range_init)    ( void );
+Bool OA_(range_watched) ( IROp op );
+void OA_(range_profile) ( IRSB* sb, IRStmt* st, OA_InstrumentContext ic,
+                          IRType hWordTy );
+void OA_(range_fini)    ( void );
+
+/*------------------------------------------------------------*/
+/*--- Precision-conversion profile (oa_convert.c)          ---*/
+/*------------------------------------------------------------*/
+
+void OA_(convert_init)    ( void );
+Bool OA_(convert_watched) ( IROp op );
+void OA_(convert_profile) ( IRSB* sb, IRStmt* st, OA_InstrumentContext ic );
+void OA_(convert_fini)    ( void );
+
+/*------------------------------------------------------------*/
+/*--- Wasted-work profile (oa_waste.c)                     ---*/
+/*------------------------------------------------------------*/
+
+void OA_(waste_init)    ( void );
+Bool OA_(waste_watched) ( IROp op );
+void OA_(waste_profile) ( IRSB* sb, IRStmt* st, OA_InstrumentContext ic );
+void OA_(waste_fini)    ( void );
+
+/*------------------------------------------------------------*/
+/*--- On-disk site cache (oa_sitecache.c)                  ---*/
+/*------------------------------------------------------------*/
+
+void OA_(sitecache_init)     ( Bool (*isMath)(const HChar* fnname),
+                               Bool (*wanted)(const HChar* fnname) );
+void OA_(sitecache_begin_SB) ( Addr64 addr );
+Bool OA_(sitecache_debug_info) ( Addr a, HChar file[COJAC_FILE_LEN],
+                                 HChar fn[COJAC_FCT_LEN], UInt* line,
+                                 Bool* isLocated );
+void OA_(sitecache_add)      ( Addr a, const HChar* file, const HChar* fn,
+                               UInt line, Bool isLocated );
+Bool OA_(sitecache_fnname_if_entry) ( Addr a, HChar* fnname, Int n );
+void OA_(sitecache_fini)     ( void );
+
+/*------------------------------------------------------------*/
+/*--- Operand variables (oa_operands.c)                    ---*/
+/*------------------------------------------------------------*/
+
+void   OA_(operands_save)     ( IRSB* sb, OA_InstrumentContext inscon,
+                                IRExpr* a1, IRExpr* a2 );
+void   OA_(operands_describe) ( OA_InstrumentContext inscon, HChar* buf, Int n );
+
+/*------------------------------------------------------------*/
+/*--- Overhead self-profiling (oa_stats.c)                 ---*/
+/*------------------------------------------------------------*/
+
+typedef enum {
+  OA_TimeInstrument,   // translation
+  OA_TimeDebugInfo,
+  OA_TimeNeedCall,
+  OA_TimeCheck,        // run time, sampled
+  OA_TimeMaybeError,
+  OA_TimeRecordError,
+  OA_TimeMAX
+} OA_StatsTimer;
+
+ULong OA_(stats_enter)       ( OA_StatsTimer t );
+void  OA_(stats_leave)       ( OA_StatsTimer t, ULong start );
+void  OA_(stats_add_check)   ( IRSB* sb, IRDirty* di );
+void  OA_(stats_translation) ( IRSB* sbIn, IRSB* sbOut );
+void  OA_(stats_extra_alloc) ( SizeT size );
+void  OA_(stats_fini)        ( void );
 
 /*------------------------------------------------------------*/
 /*--- Errors and suppressions                              ---*/
@@ -190,9 +432,13 @@ VG_REGPARM(2) void oa_callbackI64_call_1xF32(ULong la, OA_InstrumentContext ic);
 
 // For error signalling
 void OA_(maybe_error)(ErrorKind ekind, OA_InstrumentContext inscon);
+void OA_(report_if)  (IRSB* sb, IRExpr* guard, ErrorKind kind,
+                      OA_InstrumentContext inscon);
+const HChar* OA_(strFromErrorKind)(ErrorKind errKind);
 
 // As required for VG_(needs_tool_errors) (pub_tool_tooliface.h
 Bool OA_(eq_Error)           ( VgRes res, Error* e1, Error* e2 );
+UWord OA_(hash_Error)        ( Error* err );
 void OA_(before_pp_Error)    ( Error* err );
 void OA_(pp_Error)           ( Error* err );
 UInt OA_(update_Error_extra) ( Error* err );
@@ -64,41 +64,130 @@ Call_Cojac_attributes* OA_(get_Call_struct)(OA_Call call) {
   return &(oa_all_call_attr[call-Call_INVALID]);
 }
 
+//-----------------------------------------------------------------
+/* The error kinds that the checks of an IROp can report. An op is not
+ * instrumented at all when none of them is enabled with --kinds. */
+static UInt kindsOfIROp(IROp op) {
+  switch(op) {
+    case Iop_Add16: case Iop_Sub16: case Iop_Mul16:
+    case Iop_Add32: case Iop_Sub32: case Iop_Mul32:
+    case Iop_Add64: case Iop_Sub64: case Iop_Mul64:
+      return OA_KIND_BIT(Err_Overflow);
+    case Iop_DivS32: case Iop_DivS64:
+    case Iop_DivModS64to32: case Iop_DivModS128to64:
+      return OA_KIND_BIT(Err_Overflow) | OA_KIND_BIT(Err_DivByZero);
+    case Iop_DivU32: case Iop_DivU64:
+    case Iop_DivModU64to32: case Iop_DivModU128to64:
+      return OA_KIND_BIT(Err_DivByZero);
+    case Iop_64to32: case Iop_32to16: case Iop_32to8: case Iop_16to8:
+      return OA_KIND_BIT(Err_Cast);
+    case Iop_F64toI32S: case Iop_F64toI64S: case Iop_F32toI32S:
+    case Iop_F64toI32U: case Iop_F64toI64U:
+      return OA_KIND_BIT(Err_Overflow) | OA_KIND_BIT(Err_Infinity) | OA_KIND_BIT(Err_NaN);
+    case Iop_F64toF32:
+      return OA_KIND_BIT(Err_Overflow) | OA_KIND_BIT(Err_Underflow);
+    case Iop_AddF32: case Iop_SubF32: case Iop_Add32F0x4: case Iop_Sub32F0x4:
+    case Iop_AddF64: case Iop_SubF64: case Iop_Add64F0x2: case Iop_Sub64F0x2:
+    case Iop_Add64Fx2: case Iop_Sub64Fx2:
+      return OA_KIND_BIT(Err_Precision) | OA_KIND_BIT(Err_Infinity)
+           | OA_KIND_BIT(Err_NaN) | OA_KIND_BIT(Err_Cancellation);
+    case Iop_MulF32: case Iop_Mul32F0x4:
+    case Iop_MulF64: case Iop_Mul64F0x2: case Iop_Mul64Fx2:
+      return OA_KIND_BIT(Err_Infinity) | OA_KIND_BIT(Err_NaN) | OA_KIND_BIT(Err_Underflow);
+    case Iop_DivF32: case Iop_Div32F0x4:
+    case Iop_DivF64: case Iop_Div64F0x2: case Iop_Div64Fx2: case Iop_Div64Fx4:
+      return OA_KIND_BIT(Err_DivByZero) | OA_KIND_BIT(Err_Infinity)
+           | OA_KIND_BIT(Err_NaN) | OA_KIND_BIT(Err_Underflow);
+    case Iop_CmpF64: case Iop_CmpF32:
+    case Iop_CmpEQ64Fx2: case Iop_CmpLT64Fx2: case Iop_CmpLE64Fx2:
+    case Iop_CmpEQ64F0x2: case Iop_CmpLT64F0x2: case Iop_CmpLE64F0x2:
+    case Iop_CmpEQ32Fx4: case Iop_CmpLT32Fx4: case Iop_CmpLE32Fx4:
+    case Iop_CmpGT32Fx4: case Iop_CmpGE32Fx4:
+    case Iop_CmpEQ32F0x4: case Iop_CmpLT32F0x4: case Iop_CmpLE32F0x4:
+      return OA_KIND_BIT(Err_CloseComparison) | OA_KIND_BIT(Err_NaN);
+    case Iop_Sqrt64F0x2: case Iop_Sqrt64Fx2: case Iop_Sqrt64Fx4:
+      return OA_KIND_BIT(Err_NaN);
+    default:
+      return OA_ALL_KINDS;
+  }
+}
+
+static Bool worth_registering(IROp op) {
+  return (kindsOfIROp(op) & OA_(options).kinds) != 0;
+}
+
 static void init_iop(IROp op, const char* name, void* callI32, void* callI64) {
+  if (!worth_registering(op)) return;
   oa_all_iop_attr[op-Iop_INVALID].op=op;
   oa_all_iop_attr[op-Iop_INVALID].name=name;
   oa_all_iop_attr[op-Iop_INVALID].callbackI32=callI32;
   oa_all_iop_attr[op-Iop_INVALID].callbackI64=callI64;
 }
 
+/* The ops that are only counted by --kinds=...,subnormal (no callback),
+ * named for the printing of their sites */
+static void name_iop(IROp op, const char* name) {
+  oa_all_iop_attr[op-Iop_INVALID].op=op;
+  oa_all_iop_attr[op-Iop_INVALID].name=name;
+}
+
+static void init_fused(IROp op, const char* name, void* fusedI64) {
+  if (!worth_registering(op)) return;
+  oa_all_iop_attr[op-Iop_INVALID].op=op;
+  oa_all_iop_attr[op-Iop_INVALID].name=name;
+  oa_all_iop_attr[op-Iop_INVALID].fusedI64=fusedI64;
+}
+
+/* The name is always registered (--site-cache lists the entries of all
+ * the math functions), the callbacks only if the function is watched */
 static void init_call(OA_Call call, const char* name, void* callI32, void* callI64, OA_Param_Type pType) {
   oa_all_call_attr[call-Call_INVALID].call=call;
   oa_all_call_attr[call-Call_INVALID].name=name;
+  oa_all_call_attr[call-Call_INVALID].paramType=pType;
+  if (!OA_(options).mathOp) return;
+  // the watched math functions can only produce NaN or infinite results
+  if (!OA_KIND_ON(Err_NaN) && !OA_KIND_ON(Err_Infinity)) return;
   oa_all_call_attr[call-Call_INVALID].callbackI32=callI32;
   oa_all_call_attr[call-Call_INVALID].callbackI64=callI64;
-  oa_all_call_attr[call-Call_INVALID].paramType=pType;
 }
 
 
 static void populate_iop_struct(void) {
   Iop_Cojac_attributes a;
-  a.callbackI32=NULL; a.callbackI64=NULL; a.name=""; a.occurrences=0;
+  a.callbackI32=NULL; a.callbackI64=NULL; a.fusedI64=NULL; a.name=""; a.occurrences=0;
   int i=0;
   for(i=0; i<OA_IOP_MAX; i++)
     oa_all_iop_attr[i]=a;
 
+  if (OA_KIND_ON(Err_Subnormal)) {
+    name_iop(Iop_Add32Fx4,   "Add32Fx4");
+    name_iop(Iop_Sub32Fx4,   "Sub32Fx4");
+    name_iop(Iop_Mul32Fx4,   "Mul32Fx4");
+    name_iop(Iop_Div32Fx4,   "Div32Fx4");
+    name_iop(Iop_Sqrt32Fx4,  "Sqrt32Fx4");
+    name_iop(Iop_Sqrt32F0x4, "Sqrt32F0x4");
+    name_iop(Iop_Sqrt64F0x2, "Sqrt64F0x2");
+  }
+
   if (OA_(options).i32) {
     init_iop(Iop_Add32,   "Add32",  oa_callbackI32_2x32, oa_callbackI64_2x32);
     init_iop(Iop_Sub32,   "Sub32",  oa_callbackI32_2x32, oa_callbackI64_2x32);
     init_iop(Iop_Mul32,   "Mul32",  oa_callbackI32_2x32, oa_callbackI64_2x32);
-    init_iop(Iop_DivS32,  "DivS32", oa_callbackI32_2x32, oa_callbackI64_2x32);
+    // integer divisions are checked inline, see instrument_IntDiv
+    init_iop(Iop_DivS32,  "DivS32", oa_inline_report, oa_inline_report);
+    init_iop(Iop_DivU32,  "DivU32", oa_inline_report, oa_inline_report);
+    init_iop(Iop_DivModS64to32, "DivModS64to32", oa_inline_report, oa_inline_report);
+    init_iop(Iop_DivModU64to32, "DivModU64to32", oa_inline_report, oa_inline_report);
   }
 
   if (OA_(options).i64) {
     init_iop(Iop_Add64,   "Add64",  oa_callbackI32_2x64, oa_callbackI64_2x64);
     init_iop(Iop_Sub64,   "Sub64",  oa_callbackI32_2x64, oa_callbackI64_2x64);
     init_iop(Iop_Mul64,   "Mul64",  oa_callbackI32_2x64, oa_callbackI64_2x64);
-    init_iop(Iop_DivS64,  "DivS64", oa_callbackI32_2x64, oa_callbackI64_2x64);
+    init_iop(Iop_DivS64,  "DivS64", oa_inline_report, oa_inline_report);
+    init_iop(Iop_DivU64,  "DivU64", oa_inline_report, oa_inline_report);
+    init_iop(Iop_DivModS128to64, "DivModS128to64", oa_inline_report, oa_inline_report);
+    init_iop(Iop_DivModU128to64, "DivModU128to64", oa_inline_report, oa_inline_report);
   }
 
 
@@ -108,13 +197,27 @@ static void populate_iop_struct(void) {
     init_iop(Iop_Mul16,   "Mul16",  oa_callbackI32_2x16, oa_callbackI64_2x16);
   }
 
+  // narrowing casts are checked inline, see instrument_IntNarrowing
+  if (OA_(options).castToI32) {
+    init_iop(Iop_64to32,  "64to32", oa_inline_report, oa_inline_report);
+  }
+
   if (OA_(options).castToI16) {
-    init_iop(Iop_32to16,  "32to16", oa_callbackI32_1x32, oa_callbackI64_1x32);
+    init_iop(Iop_32to16,  "32to16", oa_inline_report, oa_inline_report);
+  }
+
+  if (OA_(options).castToI8) {
+    init_iop(Iop_32to8,   "32to8",  oa_inline_report, oa_inline_report);
+    init_iop(Iop_16to8,   "16to8",  oa_inline_report, oa_inline_report);
   }
   
   if (OA_(options).castFromF64) {
-    init_iop(Iop_F64toI32S, "F64toI32S",  oa_callbackI64_1xI32_1xF64, oa_callbackI64_1xI32_1xF64);
-    init_iop(Iop_F64toI64S, "F64toI64S",  oa_callbackI64_1xI32_1xF64, oa_callbackI64_1xI32_1xF64);
+    // range checked inline, see instrument_FPNarrowing
+    init_iop(Iop_F64toI32S, "F64toI32S",  oa_callbackI32_1xI32_1xF64, oa_callbackI64_1xI32_1xF64);
+    init_iop(Iop_F64toI32U, "F64toI32U",  oa_callbackI32_1xI32_1xF64, oa_callbackI64_1xI32_1xF64);
+    init_iop(Iop_F64toI64S, "F64toI64S",  oa_callbackI32_1xI32_1xF64, oa_callbackI64_1xI32_1xF64);
+    init_iop(Iop_F64toI64U, "F64toI64U",  oa_callbackI32_1xI32_1xF64, oa_callbackI64_1xI32_1xF64);
+    init_iop(Iop_F32toI32S, "F32toI32S",  oa_callbackI32_1xI32_1xF64, oa_callbackI64_1xI32_1xF64);
     init_iop(Iop_F64toF32, "F64toF32",  oa_callbackI64_1xI32_1xF64, oa_callbackI64_1xI32_1xF64);
   }
 
@@ -127,6 +230,16 @@ static void populate_iop_struct(void) {
     init_iop(Iop_Sub32F0x4,  "Sub32F0x4", oa_callbackI32_2xF32, oa_callbackI64_2xF32);
     init_iop(Iop_Mul32F0x4,  "Mul32F0x4", oa_callbackI32_2xF32, oa_callbackI64_2xF32);
     init_iop(Iop_Div32F0x4,  "Div32F0x4", oa_callbackI32_2xF32, oa_callbackI64_2xF32);
+    init_iop(Iop_CmpF32,     "CmpF32",    oa_callbackI32_2xF32, oa_callbackI64_2xF32);
+    // packed compares: amd64 only
+    init_iop(Iop_CmpEQ32Fx4,  "CmpEQ32Fx4",  NULL, oa_callbackI64_cmp32F);
+    init_iop(Iop_CmpLT32Fx4,  "CmpLT32Fx4",  NULL, oa_callbackI64_cmp32F);
+    init_iop(Iop_CmpLE32Fx4,  "CmpLE32Fx4",  NULL, oa_callbackI64_cmp32F);
+    init_iop(Iop_CmpGT32Fx4,  "CmpGT32Fx4",  NULL, oa_callbackI64_cmp32F);
+    init_iop(Iop_CmpGE32Fx4,  "CmpGE32Fx4",  NULL, oa_callbackI64_cmp32F);
+    init_iop(Iop_CmpEQ32F0x4, "CmpEQ32F0x4", NULL, oa_callbackI64_cmp32F);
+    init_iop(Iop_CmpLT32F0x4, "CmpLT32F0x4", NULL, oa_callbackI64_cmp32F);
+    init_iop(Iop_CmpLE32F0x4, "CmpLE32F0x4", NULL, oa_callbackI64_cmp32F);
   }
 
   if (OA_(options).f64) {
@@ -143,11 +256,29 @@ static void populate_iop_struct(void) {
     init_iop(Iop_Div64F0x2,"Div64F0x2", oa_callbackI32_2xF64, oa_callbackI64_2xF64);
     init_iop(Iop_Div64Fx2, "Div64Fx2",  oa_callbackI32_2xF64, oa_callbackI64_2xF64);
     init_iop(Iop_CmpF64, "CmpF64",  oa_callbackI32_2xF64, oa_callbackI64_2xF64);
+    // packed compares: amd64 only
+    init_iop(Iop_CmpEQ64Fx2,  "CmpEQ64Fx2",  NULL, oa_callbackI64_cmp64F);
+    init_iop(Iop_CmpLT64Fx2,  "CmpLT64Fx2",  NULL, oa_callbackI64_cmp64F);
+    init_iop(Iop_CmpLE64Fx2,  "CmpLE64Fx2",  NULL, oa_callbackI64_cmp64F);
+    init_iop(Iop_CmpEQ64F0x2, "CmpEQ64F0x2", NULL, oa_callbackI64_cmp64F);
+    init_iop(Iop_CmpLT64F0x2, "CmpLT64F0x2", NULL, oa_callbackI64_cmp64F);
+    init_iop(Iop_CmpLE64F0x2, "CmpLE64F0x2", NULL, oa_callbackI64_cmp64F);
   }
   
   if (OA_(options).mathOp) {
     init_iop(Iop_Sqrt64Fx2, "Sqrt64Fx2",  oa_callbackI32_1xF64, oa_callbackI64_1xF64);
   }
+
+  if (OA_(options).fusedOps && OA_(options).f64) {
+    init_fused(Iop_Div64F0x2, "Div64F0x2", oa_fusedI64_DivF64);
+    init_fused(Iop_Div64Fx2,  "Div64Fx2",  oa_fusedI64_DivF64);
+    init_fused(Iop_Div64Fx4,  "Div64Fx4",  oa_fusedI64_DivF64);
+  }
+  if (OA_(options).fusedOps && OA_(options).mathOp) {
+    init_fused(Iop_Sqrt64F0x2, "Sqrt64F0x2", oa_fusedI64_SqrtF64);
+    init_fused(Iop_Sqrt64Fx2,  "Sqrt64Fx2",  oa_fusedI64_SqrtF64);
+    init_fused(Iop_Sqrt64Fx4,  "Sqrt64Fx4",  oa_fusedI64_SqrtF64);
+  }
 }
 
 /*On init call, the name og the function need to be the same as the real function name.
@@ -159,17 +290,15 @@ static void populate_call_struct(void) {
   for(i=0; i<OA_CALL_MAX; i++)
     oa_all_call_attr[i]=a;
   
-  if (OA_(options).mathOp) {
-    //1xF64 param
-    init_call(Call_Asin, "asin",  oa_callbackI32_call_1xF64, oa_callbackI64_call_1xF64, Call_1xF64);
-    init_call(Call_Sqrt, "sqrt",  oa_callbackI32_call_1xF64, oa_callbackI64_call_1xF64, Call_1xF64);
-    init_call(Call_Log, "log",  oa_callbackI32_call_1xF64, oa_callbackI64_call_1xF64, Call_1xF64);
-    
-    //1xF32 param
-    init_call(Call_Asinf, "asinf",  oa_callbackI32_call_1xF32, oa_callbackI64_call_1xF32, Call_1xF32);
-    init_call(Call_Sqrtf, "sqrtf",  oa_callbackI32_call_1xF32, oa_callbackI64_call_1xF32, Call_1xF32);
-    init_call(Call_Logf, "logf",  oa_callbackI32_call_1xF32, oa_callbackI64_call_1xF32, Call_1xF32);
-  }
+  //1xF64 param
+  init_call(Call_Asin, "asin",  oa_callbackI32_call_1xF64, oa_callbackI64_call_1xF64, Call_1xF64);
+  init_call(Call_Sqrt, "sqrt",  oa_callbackI32_call_1xF64, oa_callbackI64_call_1xF64, Call_1xF64);
+  init_call(Call_Log, "log",  oa_callbackI32_call_1xF64, oa_callbackI64_call_1xF64, Call_1xF64);
+
+  //1xF32 param
+  init_call(Call_Asinf, "asinf",  oa_callbackI32_call_1xF32, oa_callbackI64_call_1xF32, Call_1xF32);
+  init_call(Call_Sqrtf, "sqrtf",  oa_callbackI32_call_1xF32, oa_callbackI64_call_1xF32, Call_1xF32);
+  init_call(Call_Logf, "logf",  oa_callbackI32_call_1xF32, oa_callbackI64_call_1xF32, Call_1xF32);
 }
 
 static Bool dropV128HiPart(IROp op) {
@@ -178,6 +307,48 @@ static Bool dropV128HiPart(IROp op) {
 		case Iop_Sub64F0x2:
 		case Iop_Mul64F0x2:
 		case Iop_Div64F0x2:
+		case Iop_CmpEQ64F0x2:
+		case Iop_CmpLT64F0x2:
+		case Iop_CmpLE64F0x2:
+		case Iop_CmpEQ32F0x4:
+		case Iop_CmpLT32F0x4:
+		case Iop_CmpLE32F0x4:
+			return True;
+		default: return False;
+	}
+}
+
+static Bool isIntDiv(IROp op) {
+  switch(op) {
+    case Iop_DivS32: case Iop_DivU32: case Iop_DivS64: case Iop_DivU64:
+    case Iop_DivModS64to32: case Iop_DivModU64to32:
+    case Iop_DivModS128to64: case Iop_DivModU128to64:
+      return True;
+    default:
+      return False;
+  }
+}
+
+static Bool isNarrowing(IROp op) {
+  switch(op) {
+    case Iop_64to32: case Iop_32to16: case Iop_32to8: case Iop_16to8:
+    case Iop_F64toI32S: case Iop_F64toI32U: case Iop_F64toI64S: case Iop_F64toI64U:
+    case Iop_F32toI32S:
+      return True;
+    default:
+      return False;
+  }
+}
+
+/* Packed compares pass all their lanes to one callback:
+ * (a.lo, a.hi, b.lo, b.hi, ic) */
+static Bool isPackedCmp(IROp op) {
+	switch(op) {
+		case Iop_CmpEQ64Fx2:  case Iop_CmpLT64Fx2:  case Iop_CmpLE64Fx2:
+		case Iop_CmpEQ64F0x2: case Iop_CmpLT64F0x2: case Iop_CmpLE64F0x2:
+		case Iop_CmpEQ32Fx4:  case Iop_CmpLT32Fx4:  case Iop_CmpLE32Fx4:
+		case Iop_CmpGT32Fx4:  case Iop_CmpGE32Fx4:
+		case Iop_CmpEQ32F0x4: case Iop_CmpLT32F0x4: case Iop_CmpLE32F0x4:
 			return True;
 		default: return False;
 	}
@@ -188,6 +359,12 @@ static void get_debug_info(Addr instr_addr, HChar file[COJAC_FILE_LEN],
                            HChar fn[COJAC_FCT_LEN], UInt* line, Bool* isLocated) {
   HChar dir[COJAC_FILE_LEN];
   Bool found_dirname;
+  ULong t0 = OA_(stats_enter)(OA_TimeDebugInfo);
+  if (OA_(options).siteCache != NULL
+      && OA_(sitecache_debug_info)(instr_addr, file, fn, line, isLocated)) {
+    OA_(stats_leave)(OA_TimeDebugInfo, t0);
+    return;
+  }
   Bool found_file_line = VG_(get_filename_linenum)(
       instr_addr,
       file, COJAC_FILE_LEN,
@@ -195,6 +372,7 @@ static void get_debug_info(Addr instr_addr, HChar file[COJAC_FILE_LEN],
       line
   );
   Bool found_fn = VG_(get_fnname)(instr_addr, fn, COJAC_FCT_LEN);
+  OA_(stats_leave)(OA_TimeDebugInfo, t0);
   *isLocated=True;
   if (!found_file_line) {
     VG_(strcpy)(file, "???");
@@ -212,6 +390,8 @@ static void get_debug_info(Addr instr_addr, HChar file[COJAC_FILE_LEN],
     VG_(strcat)(dir, file);    // Append file to dir
     VG_(strcpy)(file, dir);    // Move dir+file to file
   }
+  if (OA_(options).siteCache != NULL)
+    OA_(sitecache_add)(instr_addr, file, fn, *line, *isLocated);
 }
 //-----------------------------------------------------------------
 static void* callbackFromIROp(IROp op) {
@@ -269,6 +449,8 @@ static void print_instrumentation_stats(void) {
     if (a.occurrences >0)
       VG_(message)(Vg_UserMsg, "%s \t %lld \n", a.name, a.occurrences);
   }
+  OA_(groups_print_stats)();
+  OA_(tier_print_stats)();
 }
 
 
@@ -360,6 +542,104 @@ static void packToI32orI64 ( IRSB* sb, IRExpr* e, IRExpr* res[2], IROp irop) {
   }
 }
 
+//-----------------------------------------------------------------
+// Operands are only batched on amd64, where each fits in one I64.
+static Bool use_batch(void) {
+  return OA_(options).batch && thisWordWidth==Ity_I64;
+}
+
+//-----------------------------------------------------------------
+/* --symbolize=deferred: a site is located when its object has line info
+ * at all, which is found once per object by probing its text symbols up
+ * to the first one with a line. The last object is remembered within a
+ * superblock only (a superblock does not span objects), and the objects
+ * whose text is unmapped are forgotten. */
+typedef struct _OA_ObjLines {
+  struct _OA_ObjLines* next;
+  const DebugInfo* di;
+  Addr  avma;
+  SizeT size;
+  Bool  hasLines;
+} OA_ObjLines;
+
+static OA_ObjLines* objLines = NULL;
+static OA_ObjLines* lastObj  = NULL;
+
+static Bool probe_lines(const DebugInfo* di) {
+  HChar file[COJAC_FILE_LEN];
+  HChar dir[COJAC_FILE_LEN];
+  Bool  hasDir;
+  UInt  line;
+  Int   i, n = VG_(DebugInfo_syms_howmany)(di);
+  for (i = 0; i < n; i++) {
+    Addr   avma, tocptr;
+    UInt   size;
+    HChar* name;
+    HChar** secNames;
+    Bool   isText, isIFunc;
+    VG_(DebugInfo_syms_getidx)(di, i, &avma, &tocptr, &size, &name,
+                               &secNames, &isText, &isIFunc);
+    if (!isText) continue;
+    if (VG_(get_filename_linenum)(avma, file, sizeof(file),
+                                  dir, sizeof(dir), &hasDir, &line))
+      return True;
+  }
+  return False;
+}
+
+static Bool object_has_lines(Addr a) {
+  HChar thisFct[]="object_has_lines";
+  const DebugInfo* di;
+  OA_ObjLines* o;
+  if (lastObj != NULL && a >= lastObj->avma && a < lastObj->avma + lastObj->size)
+    return lastObj->hasLines;
+  di = VG_(find_DebugInfo)(a);
+  if (di == NULL) return False;
+  for (o = objLines; o != NULL; o = o->next)
+    if (o->di == di && o->avma == VG_(DebugInfo_get_text_avma)(di)) break;
+  if (o == NULL) {
+    ULong t0 = OA_(stats_enter)(OA_TimeDebugInfo);
+    o = VG_(malloc)(thisFct, sizeof(OA_ObjLines));
+    o->di       = di;
+    o->avma     = VG_(DebugInfo_get_text_avma)(di);
+    o->size     = VG_(DebugInfo_get_text_size)(di);
+    o->hasLines = probe_lines(di);
+    o->next     = objLines;
+    objLines    = o;
+    OA_(stats_leave)(OA_TimeDebugInfo, t0);
+  }
+  lastObj = o;
+  return o->hasLines;
+}
+
+/* An object may be unmapped, and another one loaded at its address */
+static void forget_objects(Addr a, SizeT len) {
+  OA_ObjLines **p = &objLines, *o;
+  while ((o = *p) != NULL) {
+    if (o->avma < a + len && a < o->avma + o->size) {
+      *p = o->next;
+      if (o == lastObj) lastObj = NULL;
+      VG_(free)(o);
+    } else {
+      p = &o->next;
+    }
+  }
+}
+
+/* Whether the debug info locates the code at a (see not_worth_watching).
+ * File, function and line are not kept: the sites that raise something
+ * are symbolized when they are printed, at exit. */
+static Bool site_located(Addr a) {
+  HChar file[COJAC_FILE_LEN];
+  HChar fn[COJAC_FCT_LEN];
+  UInt  line;
+  Bool  located;
+  if (OA_(options).isAggr) return True;  // not consulted
+  if (OA_(options).deferredSymbols) return object_has_lines(a);
+  get_debug_info(a, file, fn, &line, &located);
+  return located;
+}
+
 //-----------------------------------------------------------------
 // Determines when it is worth inspecting arithmetic. Typical "modes":
 // - always (return False)
@@ -372,12 +652,8 @@ static Bool not_worth_watching(OA_InstrumentContext ic) {
 }
 //-----------------------------------------------------------------
 static OA_InstrumentContext contextForIop(Addr64 cia, IROp op) {
-  HChar thisFct[]="contextForIop";
-  OA_InstrumentContext ic=VG_(malloc)(thisFct, sizeof(OA_InstrumentContext_));
-  UInt     line;
-  HChar    filename[COJAC_FILE_LEN];
-  HChar    fctname[COJAC_FCT_LEN];
-  get_debug_info((Addr)cia, filename, fctname, &line, &(ic->isLocated));
+  OA_InstrumentContext ic=OA_(new_context)();
+  ic->isLocated = site_located((Addr)cia);
   ic->string = strFromIROp(op);
   ic->addr = (Addr)cia;
   ic->op=op;
@@ -388,12 +664,8 @@ static OA_InstrumentContext contextForIop(Addr64 cia, IROp op) {
 }
 //-----------------------------------------------------------------
 static OA_InstrumentContext contextForCall(Addr64 cia, OA_Call call) {
-  HChar thisFct[]="contextForCall";
-  OA_InstrumentContext ic=VG_(malloc)(thisFct, sizeof(OA_InstrumentContext_));
-  UInt     line;
-  HChar    filename[COJAC_FILE_LEN];
-  HChar    fctname[COJAC_FCT_LEN];
-  get_debug_info((Addr)cia, filename, fctname, &line, &(ic->isLocated));
+  OA_InstrumentContext ic=OA_(new_context)();
+  ic->isLocated = site_located((Addr)cia);
   ic->string = strFromOACall(call);
   ic->addr = (Addr)cia;
   ic->call=call;
@@ -403,6 +675,250 @@ static OA_InstrumentContext contextForCall(Addr64 cia, OA_Call call) {
   return ic;
 }
 
+//-----------------------------------------------------------------
+/* Adds the checking dirty call of ic, guarded when the checks are scoped
+ * or sampled (and timed with --cojac-stats=yes) */
+static void addCheckToIRSB(IRSB* sb, IRDirty* di, OA_InstrumentContext ic) {
+  IRExpr* guard = OA_(scope_and_guard)(sb, OA_(tier_guard)(sb, ic));
+  if (guard != NULL)
+    di->guard = guard;
+  OA_(stats_add_check)(sb, di);
+}
+
+//-----------------------------------------------------------------
+/* --describe-operands: where the operands of ic come from, saved before
+ * its check (see oa_operands.c) */
+static void save_operands(IRSB* sb, OA_InstrumentContext ic, IRExpr* a1, IRExpr* a2) {
+  if (OA_(options).describeOperands && !use_batch())
+    OA_(operands_save)(sb, ic, a1, a2);
+}
+
+//-----------------------------------------------------------------
+/* Integer divisions: the division by zero and the INT_MIN/-1 overflow are
+ * plain comparisons, so they are computed in IR, and oa_inline_report is
+ * only called (guarded) when one of them holds. The division paths are
+ * thus left without any helper call. The DivMod forms are what x86/amd64
+ * div/idiv are translated to: the dividend is twice as wide as the divisor,
+ * a sign-extended INT_MIN overflows the 32 (resp. 64) bit quotient. */
+
+static IRExpr* isEqualTo(IRSB* sb, IRExpr* a, IRType ty, ULong c) {
+  if (ty == Ity_I64)
+    return OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpEQ64, a, IRExpr_Const(IRConst_U64(c))));
+  return OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpEQ32, a, IRExpr_Const(IRConst_U32((UInt)c))));
+}
+
+static IRExpr* bothTrue(IRSB* sb, IRExpr* g1, IRExpr* g2) {
+  IRExpr* w1 = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, g1));
+  IRExpr* w2 = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, g2));
+  IRExpr* w  = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32, w1, w2));
+  return OA_(newTmp)(sb, Ity_I1, IRExpr_Unop(Iop_32to1, w));
+}
+
+/* A report of kind at inscon, when guard holds (also used by the
+ * predicates of oa_count.c in the hot superblocks) */
+void OA_(report_if)(IRSB* sb, IRExpr* guard, ErrorKind kind,
+                    OA_InstrumentContext inscon) {
+  if (OA_(options).countOnly) {
+    OA_(count_if)(sb, guard, kind, inscon);
+    return;
+  }
+  IRDirty* di = unsafeIRDirty_0_N(2, "inline_report",
+                                  VG_(fnptr_to_fnentry)(oa_inline_report),
+                                  mkIRExprVec_2(mkIRExpr_HWord((HWord)kind),
+                                                mkIRExpr_HWord((HWord)inscon)));
+  di->guard = OA_(scope_and_guard)(sb, guard);
+  addStmtToIRSB(sb, IRStmt_Dirty(di));
+}
+
+static void instrument_IntDiv(IRSB* sb, IRExpr* op, OA_InstrumentContext inscon) {
+  IROp    irop = op->Iex.Binop.op;
+  IRExpr* a = op->Iex.Binop.arg1;
+  IRExpr* b = op->Iex.Binop.arg2;
+  IRExpr* ovf = NULL;
+  IRType  ty;
+  switch(irop) {
+    case Iop_DivS32:
+      ty = Ity_I32;
+      if (OA_KIND_ON(Err_Overflow))
+        ovf = isEqualTo(sb, a, Ity_I32, 0x80000000ULL);
+      break;
+    case Iop_DivModS64to32:
+      ty = Ity_I32;
+      if (OA_KIND_ON(Err_Overflow))
+        ovf = isEqualTo(sb, a, Ity_I64, 0xFFFFFFFF80000000ULL);
+      break;
+    case Iop_DivS64:
+      ty = Ity_I64;
+      if (OA_KIND_ON(Err_Overflow))
+        ovf = isEqualTo(sb, a, Ity_I64, 0x8000000000000000ULL);
+      break;
+    case Iop_DivModS128to64:
+      ty = Ity_I64;
+      if (OA_KIND_ON(Err_Overflow)) {
+        IRExpr* lo = OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(Iop_128to64, a));
+        IRExpr* hi = OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(Iop_128HIto64, a));
+        ovf = bothTrue(sb, isEqualTo(sb, lo, Ity_I64, 0x8000000000000000ULL),
+                           isEqualTo(sb, hi, Ity_I64, ~0ULL));
+      }
+      break;
+    case Iop_DivU32: case Iop_DivModU64to32:
+      ty = Ity_I32;
+      break;
+    default:  // DivU64, DivModU128to64
+      ty = Ity_I64;
+      break;
+  }
+  if (OA_KIND_ON(Err_DivByZero))
+    OA_(report_if)(sb, isEqualTo(sb, b, ty, 0), Err_DivByZero, inscon);
+  if (ovf != NULL)
+    OA_(report_if)(sb, bothTrue(sb, ovf, isEqualTo(sb, b, ty, ~0ULL)),
+                   Err_Overflow, inscon);
+}
+
+//-----------------------------------------------------------------
+/* Narrowing casts. Integers: the value must fit in the narrower type,
+ * either as signed or as unsigned (the signedness is lost in the binary),
+ * ie. the dropped bits must all be zero or all be copies of the sign bit of
+ * the result. F64/F32 to integer: CmpF64 with the bounds of the integer
+ * type, so that NaN (unordered) also fails. In both cases the helper is
+ * only called, guarded, when the value is actually truncated, which keeps
+ * these very frequent operations free of calls. */
+
+static IRExpr* neitherTrue(IRSB* sb, IRExpr* g1, IRExpr* g2) {
+  IRExpr* w1 = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, g1));
+  IRExpr* w2 = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, g2));
+  IRExpr* w  = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Or32, w1, w2));
+  return isEqualTo(sb, w, Ity_I32, 0);
+}
+
+/* mul/imul with a double-width result (also used by compilers for the
+ * division by a constant), and div/idiv, whose result packs the remainder
+ * above the quotient: their low half is not a truncation. The defining
+ * statement is looked for backwards, it is usually a few statements away. */
+static Bool isDoubleWidthResult(IRSB* sb, IRExpr* e) {
+  Int i;
+  if (e->tag != Iex_RdTmp) return False;
+  for (i = sb->stmts_used-1; i >= 0; i--) {
+    IRStmt* st = sb->stmts[i];
+    if (st->tag != Ist_WrTmp || st->Ist.WrTmp.tmp != e->Iex.RdTmp.tmp) continue;
+    e = st->Ist.WrTmp.data;
+    if (e->tag != Iex_Binop) return False;
+    switch (e->Iex.Binop.op) {
+      case Iop_MullU32: case Iop_MullS32: case Iop_MullU16: case Iop_MullS16:
+      case Iop_MullU8:  case Iop_MullS8:
+      case Iop_DivModU64to32: case Iop_DivModS64to32:
+        return True;
+      default:
+        return False;
+    }
+  }
+  return False;
+}
+
+static void instrument_IntNarrowing(IRSB* sb, IRExpr* op, OA_InstrumentContext inscon) {
+  IRExpr* a = op->Iex.Unop.arg;
+  IRExpr *lo, *fitsS, *fitsU;
+  switch(op->Iex.Unop.op) {
+    case Iop_64to32:
+      lo    = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_64to32, a));
+      lo    = OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(Iop_32Sto64, lo));
+      fitsS = OA_(newTmp)(sb, Ity_I1,  IRExpr_Binop(Iop_CmpEQ64, lo, a));
+      fitsU = isEqualTo(sb, OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_64HIto32, a)),
+                        Ity_I32, 0);
+      break;
+    case Iop_32to16:
+      lo    = OA_(newTmp)(sb, Ity_I16, IRExpr_Unop(Iop_32to16, a));
+      lo    = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_16Sto32, lo));
+      fitsS = OA_(newTmp)(sb, Ity_I1,  IRExpr_Binop(Iop_CmpEQ32, lo, a));
+      fitsU = isEqualTo(sb, OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Shr32, a,
+                                           IRExpr_Const(IRConst_U8(16)))), Ity_I32, 0);
+      break;
+    case Iop_32to8:
+      lo    = OA_(newTmp)(sb, Ity_I8,  IRExpr_Unop(Iop_32to8, a));
+      lo    = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_8Sto32, lo));
+      fitsS = OA_(newTmp)(sb, Ity_I1,  IRExpr_Binop(Iop_CmpEQ32, lo, a));
+      fitsU = isEqualTo(sb, OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Shr32, a,
+                                           IRExpr_Const(IRConst_U8(8)))), Ity_I32, 0);
+      break;
+    default:  // 16to8, compared as I32
+      lo    = OA_(newTmp)(sb, Ity_I8,  IRExpr_Unop(Iop_16to8, a));
+      lo    = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_8Sto32, lo));
+      fitsS = OA_(newTmp)(sb, Ity_I1,  IRExpr_Binop(Iop_CmpEQ32, lo,
+                             OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_16Sto32, a))));
+      a     = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_16Uto32, a));
+      fitsU = isEqualTo(sb, OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Shr32, a,
+                                           IRExpr_Const(IRConst_U8(8)))), Ity_I32, 0);
+      break;
+  }
+  OA_(report_if)(sb, neitherTrue(sb, fitsS, fitsU), Err_Cast, inscon);
+}
+
+/* --mode=count: the NaN and the infinities out of guard are counted as
+ * Err_NaN and Err_Infinity, the finite values out of range as Err_Overflow
+ * (check_F64toI32S and co. report an infinity as both) */
+static void count_FPNarrowing(IRSB* sb, IRExpr* a, IRExpr* guard,
+                              OA_InstrumentContext inscon) {
+  IRExpr* cmpA = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_CmpF64, a, a));
+  IRExpr* nan  = isEqualTo(sb, cmpA, Ity_I32, Ircr_UN);
+  IRExpr* absA = OA_(newTmp)(sb, Ity_F64, IRExpr_Unop(Iop_AbsF64, a));
+  IRExpr* cmpI = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_CmpF64, absA,
+                             IRExpr_Const(IRConst_F64i(0x7FF0000000000000ULL))));
+  IRExpr* inf  = isEqualTo(sb, cmpI, Ity_I32, Ircr_EQ);
+  if (OA_KIND_ON(Err_NaN))
+    OA_(count_if)(sb, nan, Err_NaN, inscon);
+  if (OA_KIND_ON(Err_Infinity))
+    OA_(count_if)(sb, inf, Err_Infinity, inscon);
+  if (OA_KIND_ON(Err_Overflow))
+    OA_(count_if)(sb, bothTrue(sb, guard, neitherTrue(sb, nan, inf)),
+                  Err_Overflow, inscon);
+}
+
+/* The callback gets the rounding mode and the value (as F64), like
+ * the former unconditional check did; on x86, the value in two halves */
+static void instrument_FPNarrowing(IRSB* sb, IRExpr* op, void* f,
+                                   OA_InstrumentContext inscon) {
+  IRExpr* a = op->Iex.Binop.arg2;
+  Double  lo, hi;   // exclusive bounds
+  switch(op->Iex.Binop.op) {
+    case Iop_F32toI32S:
+      a  = OA_(newTmp)(sb, Ity_F64, IRExpr_Unop(Iop_F32toF64, a));
+      // fall through
+    case Iop_F64toI32S: lo = -2147483649.0;          hi = 2147483648.0;          break;
+    case Iop_F64toI32U: lo = -1.0;                   hi = 4294967296.0;          break;
+    case Iop_F64toI64S: lo = -9223372036854777856.0; hi = 9223372036854775808.0; break;
+    default:            lo = -1.0;                   hi = 18446744073709551616.0; break;
+  }
+  IRExpr* cmpLo = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_CmpF64, a,
+                                              IRExpr_Const(IRConst_F64(lo))));
+  IRExpr* cmpHi = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_CmpF64, a,
+                                              IRExpr_Const(IRConst_F64(hi))));
+  // in range when a > lo (Ircr_GT == 0) and a < hi (Ircr_LT == 1)
+  IRExpr* offHi = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Xor32, cmpHi,
+                                              IRExpr_Const(IRConst_U32(Ircr_LT))));
+  IRExpr* off   = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Or32, cmpLo, offHi));
+  IRExpr* guard = OA_(newTmp)(sb, Ity_I1,  IRExpr_Binop(Iop_CmpNE32, off,
+                                              IRExpr_Const(IRConst_U32(0))));
+  if (OA_(options).countOnly) {
+    count_FPNarrowing(sb, a, guard, inscon);
+    return;
+  }
+  IRExpr* la    = OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(Iop_ReinterpF64asI64, a));
+  IRDirty* di;
+  if (thisWordWidth == Ity_I32) {
+    IRExpr* la1 = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_64HIto32, la));
+    IRExpr* la0 = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_64to32, la));
+    di = unsafeIRDirty_0_N(0, "fp_narrowing", VG_(fnptr_to_fnentry)(f),
+                           mkIRExprVec_4(op->Iex.Binop.arg1, la1, la0,
+                                         mkIRExpr_HWord((HWord)inscon)));
+  } else {
+    di = unsafeIRDirty_0_N(3, "fp_narrowing", VG_(fnptr_to_fnentry)(f),
+                           mkIRExprVec_3(op->Iex.Binop.arg1, la,
+                                         mkIRExpr_HWord((HWord)inscon)));
+  }
+  di->guard = OA_(scope_and_guard)(sb, guard);
+  addStmtToIRSB(sb, IRStmt_Dirty(di));
+}
+
 //-----------------------------------------------------------------
 static void instrument_Unop(IRSB* sb, IRStmt* st, Addr64 cia) {
   HChar thisFct[]="instrument_Unop";
@@ -410,16 +926,29 @@ static void instrument_Unop(IRSB* sb, IRStmt* st, Addr64 cia) {
   IROp irop=op->Iex.Unop.op;
   void* f=callbackFromIROp(irop);
   if (f == NULL) return;
+  if (isNarrowing(irop) && isDoubleWidthResult(sb, op->Iex.Unop.arg))
+    return;  // the low half of a mul or a div, the high half is used too
   OA_InstrumentContext inscon=contextForIop(cia, irop);
-  if (not_worth_watching(inscon))
+  if (not_worth_watching(inscon)) {
+    OA_(drop_context)(inscon);
     return;  // filter events that can't be attached to source-code location
+  }
   updateStats(inscon->op);
+  save_operands(sb, inscon, op->Iex.Unop.arg, NULL);
+  if (isNarrowing(irop)) {
+    instrument_IntNarrowing(sb, op, inscon);
+    return;
+  }
   IRExpr* oa_event_expr = mkIRExpr_HWord( (HWord)inscon );
   IRExpr * args[2];
   packToI32orI64(sb, op->Iex.Unop.arg, args, irop);
+  if (use_batch()) {
+    OA_(batch_add_op)(sb, irop, f, args[0], NULL, inscon);
+    return;
+  }
   IRExpr** argv = mkIRExprVec_2(args[0], oa_event_expr);
   IRDirty* di = unsafeIRDirty_0_N( 2, thisFct, VG_(fnptr_to_fnentry)( f ), argv);
-  addStmtToIRSB( sb, IRStmt_Dirty(di) );
+  addCheckToIRSB(sb, di, inscon);
 }
 //-----------------------------------------------------------------
 /* instruments a Binary Operation Expression in a Ist_WrTmp statement */
@@ -433,22 +962,49 @@ static void instrument_Binop(IRSB* sb, IRStmt* st, IRType type, Addr64 cia) {
   void* f=callbackFromIROp(irop);
   if (f == NULL) return;
   OA_InstrumentContext inscon=contextForIop(cia, irop);
-  if (not_worth_watching(inscon))
+  if (not_worth_watching(inscon)) {
+    OA_(drop_context)(inscon);
     return;  // filter events that can't be attached to source-code location
+  }
   updateStats(inscon->op);
+  save_operands(sb, inscon, op->Iex.Binop.arg1, op->Iex.Binop.arg2);
+  if (isIntDiv(irop)) {
+    instrument_IntDiv(sb, op, inscon);
+    return;
+  }
+  if (isNarrowing(irop)) {
+    instrument_FPNarrowing(sb, op, f, inscon);
+    return;
+  }
   oa_event_expr = mkIRExpr_HWord( (HWord)inscon );
   IRExpr * args1[2];
   packToI32orI64(sb, op->Iex.Binop.arg1, args1, irop);
   IRExpr * args2[2];
   packToI32orI64(sb, op->Iex.Binop.arg2, args2, irop);
+  if (isPackedCmp(irop)) {
+    // lane-batched: one call for all the lanes (amd64 only)
+    IRExpr* zero = mkIRExpr_HWord(0);
+    argv = mkIRExprVec_5(args1[0], args1[1] != NULL ? args1[1] : zero,
+                         args2[0], args2[1] != NULL ? args2[1] : mkIRExpr_HWord(0),
+                         oa_event_expr);
+    di = unsafeIRDirty_0_N( 3, thisFct, VG_(fnptr_to_fnentry)( f ), argv);
+    addCheckToIRSB(sb, di, inscon);
+    return;
+  }
+  if (use_batch()) {
+    OA_(batch_add_op)(sb, irop, f, args1[0], args2[0], inscon);
+    if (args1[1] != NULL)
+      OA_(batch_add_op)(sb, irop, f, args1[1], args2[1], inscon);
+    return;
+  }
   argv = mkIRExprVec_3(args1[0], args2[0], oa_event_expr);
   di = unsafeIRDirty_0_N( 3, thisFct, VG_(fnptr_to_fnentry)( f ), argv);
-  addStmtToIRSB( sb, IRStmt_Dirty(di) );
+  addCheckToIRSB(sb, di, inscon);
   if (args1[1] != NULL) {
     // we need a second callback for 64bit types
     argv = mkIRExprVec_3(args1[1], args2[1], oa_event_expr);
     di = unsafeIRDirty_0_N( 3, thisFct, VG_(fnptr_to_fnentry)( f ), argv);
-    addStmtToIRSB( sb, IRStmt_Dirty(di) );
+    addCheckToIRSB(sb, di, inscon);
   }
 }
 
@@ -464,9 +1020,12 @@ static void instrument_Triop(IRSB* sb, IRStmt* st, Addr64 cia) {
   void* f=callbackFromIROp(irop);
   if (f == NULL) return;
   OA_InstrumentContext inscon=contextForIop(cia, irop);
-  if (not_worth_watching(inscon))
+  if (not_worth_watching(inscon)) {
+    OA_(drop_context)(inscon);
     return;  // filter events that can't be attached to source-code location
+  }
   updateStats(inscon->op);
+  save_operands(sb, inscon, op->Iex.Triop.details->arg2, op->Iex.Triop.details->arg3);
   oa_event_expr = mkIRExpr_HWord( (HWord)inscon );
   IRExpr * args1[2];
   packToI32orI64(sb, op->Iex.Triop.details->arg1, args1, irop);
@@ -476,13 +1035,220 @@ static void instrument_Triop(IRSB* sb, IRStmt* st, Addr64 cia) {
   packToI32orI64(sb, op->Iex.Triop.details->arg3, args3, irop);
   argv = mkIRExprVec_4(args1[0], args2[0], args3[0], oa_event_expr);
   di = unsafeIRDirty_0_N( 4, thisFct, VG_(fnptr_to_fnentry)( f ), argv);
-  addStmtToIRSB( sb, IRStmt_Dirty(di) );
+  addCheckToIRSB(sb, di, inscon);
   if (args2[1] != NULL) {
     // we need a second callback for 64bit types
     argv = mkIRExprVec_4(args1[1], args2[1], args3[1], oa_event_expr);
     di = unsafeIRDirty_0_N( 4, thisFct, VG_(fnptr_to_fnentry)( f ), argv);
-    addStmtToIRSB( sb, IRStmt_Dirty(di) );
+    addCheckToIRSB(sb, di, inscon);
+  }
+}
+
+//-----------------------------------------------------------------
+static Bool use_fused(void) {
+  return OA_(options).fusedOps && thisWordWidth==Ity_I64;
+}
+
+/* Number of 64-bit lanes computed by a fused op; a F0x2 op only computes
+ * the low lane, the high one is copied from the (first) operand. */
+static Int fusedLanes(IROp op) {
+  switch(op) {
+    case Iop_Div64F0x2: case Iop_Sqrt64F0x2: return 1;
+    case Iop_Div64Fx2:  case Iop_Sqrt64Fx2:  return 2;
+    case Iop_Div64Fx4:  case Iop_Sqrt64Fx4:  return 4;
+    default: VG_(tool_panic)("COJAC: not a fused op..."); return 0;
+  }
+}
+
+/* Extracts the 64-bit lane i of a V128 or V256 into a "flat" expression */
+static IRExpr* laneOf(IRSB* sb, IRExpr* e, Int i) {
+  IROp v128Lane[2]={Iop_V128to64, Iop_V128HIto64};
+  IROp v256Lane[4]={Iop_V256to64_0, Iop_V256to64_1, Iop_V256to64_2, Iop_V256to64_3};
+  IROp op = (typeOfIRExpr(sb->tyenv,e)==Ity_V256) ? v256Lane[i] : v128Lane[i];
+  IRTemp t = newIRTemp(sb->tyenv, Ity_I64);
+  addStmtToIRSB(sb, IRStmt_WrTmp(t, IRExpr_Unop(op, e)));
+  return IRExpr_RdTmp(t);
+}
+
+/* Replaces "t = op(a[,b])" by calls to a helper computing each lane and
+ * its diagnosis, then a report call guarded by the status word. The
+ * original statement must then be dropped. Returns False if the op is
+ * not handled that way. */
+static Bool instrument_fused(IRSB* sb, IRStmt* st, Addr64 cia) {
+  IRExpr *op = st->Ist.WrTmp.data;
+  IRExpr *a, *b=NULL;
+  IROp irop;
+  if (!use_fused()) return False;
+  if (op->tag==Iex_Binop) {
+    irop=op->Iex.Binop.op; a=op->Iex.Binop.arg1; b=op->Iex.Binop.arg2;
+  } else if (op->tag==Iex_Unop) {
+    irop=op->Iex.Unop.op;  a=op->Iex.Unop.arg;
+  } else {
+    return False;
+  }
+  void* f=OA_(get_Iop_struct)(irop)->fusedI64;
+  if (f == NULL) return False;
+  OA_InstrumentContext inscon=contextForIop(cia, irop);
+  if (not_worth_watching(inscon)) {
+    OA_(drop_context)(inscon);
+    return False;
+  }
+  updateStats(inscon->op);
+  Int i, nLanes=fusedLanes(irop);
+  IRExpr* res[4];
+  for (i=0; i<nLanes; i++) {
+    IRTemp r = newIRTemp(sb->tyenv, Ity_I64);
+    IRDirty* di;
+    if (b != NULL)
+      di = unsafeIRDirty_1_N(r, 2, "fused_binop", VG_(fnptr_to_fnentry)(f),
+                             mkIRExprVec_2(laneOf(sb, a, i), laneOf(sb, b, i)));
+    else
+      di = unsafeIRDirty_1_N(r, 1, "fused_unop", VG_(fnptr_to_fnentry)(f),
+                             mkIRExprVec_1(laneOf(sb, a, i)));
+    addStmtToIRSB(sb, IRStmt_Dirty(di));
+    res[i]=IRExpr_RdTmp(r);
+  }
+  IRExpr* result;
+  switch(nLanes) {
+    case 1:  result=IRExpr_Binop(Iop_64HLtoV128, laneOf(sb, a, 1), res[0]); break;
+    case 2:  result=IRExpr_Binop(Iop_64HLtoV128, res[1], res[0]); break;
+    default: {
+      IRTemp hi = newIRTemp(sb->tyenv, Ity_V128);
+      IRTemp lo = newIRTemp(sb->tyenv, Ity_V128);
+      addStmtToIRSB(sb, IRStmt_WrTmp(hi, IRExpr_Binop(Iop_64HLtoV128, res[3], res[2])));
+      addStmtToIRSB(sb, IRStmt_WrTmp(lo, IRExpr_Binop(Iop_64HLtoV128, res[1], res[0])));
+      result=IRExpr_Binop(Iop_V128HLtoV256, IRExpr_RdTmp(hi), IRExpr_RdTmp(lo));
+      break;
+    }
+  }
+  addStmtToIRSB(sb, IRStmt_WrTmp(st->Ist.WrTmp.tmp, result));
+
+  IRTemp status = newIRTemp(sb->tyenv, Ity_I32);
+  addStmtToIRSB(sb, IRStmt_WrTmp(status, IRExpr_Load(Iend_LE, Ity_I32,
+                mkIRExpr_HWord((HWord)&OA_(fused_status)))));
+  IRTemp guard = newIRTemp(sb->tyenv, Ity_I1);
+  addStmtToIRSB(sb, IRStmt_WrTmp(guard, IRExpr_Binop(Iop_CmpNE32,
+                IRExpr_RdTmp(status), IRExpr_Const(IRConst_U32(0)))));
+  IRDirty* di = unsafeIRDirty_0_N(1, "fused_report",
+                                  VG_(fnptr_to_fnentry)(oa_fused_report),
+                                  mkIRExprVec_1(mkIRExpr_HWord((HWord)inscon)));
+  di->guard = OA_(scope_and_guard)(sb, IRExpr_RdTmp(guard));
+  addStmtToIRSB(sb, IRStmt_Dirty(di));
+  return True;
+}
+
+//-----------------------------------------------------------------
+/* --mode=count: adds the statement, surrounded by the predicates that
+ * increment the counters of its site (see oa_count.c). The divisions are
+ * checked before, as they may trap. Returns False if st is not watched. */
+static Bool instrument_count(IRSB* sb, IRStmt* st, Addr64 cia) {
+  IRExpr* e = st->Ist.WrTmp.data;
+  IROp    irop;
+  switch (e->tag) {
+    case Iex_Unop:  irop = e->Iex.Unop.op;            break;
+    case Iex_Binop: irop = e->Iex.Binop.op;           break;
+    case Iex_Triop: irop = e->Iex.Triop.details->op;  break;
+    default: return False;
+  }
+  if (callbackFromIROp(irop) == NULL) return False;
+  if (e->tag == Iex_Unop && isNarrowing(irop)
+      && isDoubleWidthResult(sb, e->Iex.Unop.arg))
+    return False;  // as in instrument_Unop
+  OA_InstrumentContext inscon=contextForIop(cia, irop);
+  if (not_worth_watching(inscon)) {
+    OA_(drop_context)(inscon);
+    return False;
+  }
+  updateStats(inscon->op);
+  if (isIntDiv(irop)) {
+    instrument_IntDiv(sb, e, inscon);
+    addStmtToIRSB(sb, st);
+  } else if (isNarrowing(irop)) {
+    if (e->tag == Iex_Unop)
+      instrument_IntNarrowing(sb, e, inscon);
+    else
+      instrument_FPNarrowing(sb, e, NULL, inscon);
+    addStmtToIRSB(sb, st);
+  } else {
+    addStmtToIRSB(sb, st);
+    OA_(count_result)(sb, st, inscon, thisWordWidth);
+  }
+  OA_(drop_context)(inscon);  // the counters are in the site table
+  return True;
+}
+
+//-----------------------------------------------------------------
+/* --hot-tier=guard: adds the statement, followed by the predicates of
+ * oa_count.c, each guarding a report in the hot executions, and by the
+ * exact check, for the cold ones. The sites that have reported, and the
+ * operations without predicates, keep their exact check in every
+ * execution. Returns False if st is not handled here. */
+static Bool instrument_guarded(IRSB* sb, IRStmt* st, Addr64 cia) {
+  IRExpr* e = st->Ist.WrTmp.data;
+  IROp    irop;
+  Bool    predicated;
+  if (OA_(options).hotTier != OA_HotGuard) return False;
+  switch (e->tag) {
+    case Iex_Unop:  irop = e->Iex.Unop.op;            break;
+    case Iex_Binop: irop = e->Iex.Binop.op;           break;
+    case Iex_Triop: irop = e->Iex.Triop.details->op;  break;
+    default: return False;
+  }
+  if (callbackFromIROp(irop) == NULL || isIntDiv(irop) || isNarrowing(irop))
+    return False;  // the divisions and casts are checked inline already
+  OA_InstrumentContext inscon=contextForIop(cia, irop);
+  if (not_worth_watching(inscon) || OA_(site_reported)(inscon->addr)) {
+    OA_(drop_context)(inscon);
+    return False;
+  }
+  addStmtToIRSB(sb, st);
+  predicated = OA_(guard_result)(sb, st, inscon, thisWordWidth, OA_(tier_hot)(sb));
+  if (!predicated)
+    OA_(drop_context)(inscon);
+  OA_(tier_predicated)(predicated);
+  switch (e->tag) {
+    case Iex_Unop:  instrument_Unop(sb, st, cia);  break;
+    case Iex_Binop: instrument_Binop(sb, st, typeOfIRExpr(sb->tyenv, e), cia); break;
+    default:        instrument_Triop(sb, st, cia); break;
+  }
+  OA_(tier_predicated)(False);
+  return True;
+}
+
+//-----------------------------------------------------------------
+/* The profiles (--range-profile, --conversion-profile, --wasted-work) and
+ * --kinds=...,subnormal: after the (already added) statement */
+static void profile_statement(IRSB* sb, IRStmt* st, Addr64 cia) {
+  IRExpr* e;
+  IROp    irop;
+  Bool    range, convert, waste, subnormals;
+  if (st->tag != Ist_WrTmp) return;
+  if (!OA_(options).rangeProfile && !OA_(options).convertProfile
+      && !OA_(options).wastedWork && !OA_KIND_ON(Err_Subnormal)) return;
+  e = st->Ist.WrTmp.data;
+  switch (e->tag) {
+    case Iex_Unop:  irop = e->Iex.Unop.op;            break;
+    case Iex_Binop: irop = e->Iex.Binop.op;           break;
+    case Iex_Triop: irop = e->Iex.Triop.details->op;  break;
+    default: return;
   }
+  range      = OA_(options).rangeProfile && OA_(range_watched)(irop);
+  convert    = OA_(options).convertProfile && OA_(convert_watched)(irop);
+  waste      = OA_(options).wastedWork && OA_(waste_watched)(irop);
+  subnormals = OA_KIND_ON(Err_Subnormal) && OA_(subnormal_watched)(irop);
+  if (!range && !convert && !waste && !subnormals) return;
+  OA_InstrumentContext inscon=contextForIop(cia, irop);
+  if (!not_worth_watching(inscon)) {
+    if (range)
+      OA_(range_profile)(sb, st, inscon, thisWordWidth);
+    if (convert)
+      OA_(convert_profile)(sb, st, inscon);
+    if (waste)
+      OA_(waste_profile)(sb, st, inscon);
+    if (subnormals)
+      OA_(count_subnormals)(sb, st, inscon);
+  }
+  OA_(drop_context)(inscon);  // the counters are in the tables
 }
 
 /* Instrument a function call with one F64 as parameter by adding a tmp var
@@ -491,10 +1257,10 @@ static void instrument_Call_1x_F64(IRSB* sb, Addr64 cia, OA_Call call){
   HChar thisFct[]="instrument_function_call";
   IROp op = Iop_LAST;
   IRExpr* oa_event_expr;
-  OA_InstrumentContext inscon=contextForCall(cia, call);
-  oa_event_expr = mkIRExpr_HWord( (HWord)inscon );
   void *f=callbackFromOACall(call);
   if (f == NULL) return;
+  OA_InstrumentContext inscon=contextForCall(cia, call);
+  oa_event_expr = mkIRExpr_HWord( (HWord)inscon );
   updateStatsCall(call);
   IRTemp irTemp = newIRTemp(sb->tyenv, Ity_F64);
   IRExpr *get_expr = IRExpr_Get(FP_XMM0_REG, Ity_F64);
@@ -507,7 +1273,7 @@ static void instrument_Call_1x_F64(IRSB* sb, Addr64 cia, OA_Call call){
   packToI32orI64(sb, tmp_expr, args1, op);
   argv = mkIRExprVec_2(args1[0], oa_event_expr);
   di = unsafeIRDirty_0_N( 2, thisFct, VG_(fnptr_to_fnentry)(f), argv);
-  addStmtToIRSB(sb, IRStmt_Dirty(di));
+  addCheckToIRSB(sb, di, inscon);
 }
 
 /* Instrument a function call with one F32 as parameter by adding a tmp var
@@ -516,10 +1282,10 @@ static void instrument_Call_1x_F32(IRSB* sb, Addr64 cia, OA_Call call){
   HChar thisFct[]="instrument_function_call";
   IROp op = Iop_LAST;
   IRExpr* oa_event_expr;
-  OA_InstrumentContext inscon=contextForCall(cia, call);
-  oa_event_expr = mkIRExpr_HWord( (HWord)inscon );
   void *f=callbackFromOACall(call);
   if (f == NULL) return;
+  OA_InstrumentContext inscon=contextForCall(cia, call);
+  oa_event_expr = mkIRExpr_HWord( (HWord)inscon );
   updateStatsCall(call);
   IRTemp irTemp = newIRTemp(sb->tyenv, Ity_F32);
   IRExpr *get_expr = IRExpr_Get(FP_XMM0_REG, Ity_F32);
@@ -532,42 +1298,138 @@ static void instrument_Call_1x_F32(IRSB* sb, Addr64 cia, OA_Call call){
   packToI32orI64(sb, tmp_expr, args1, op);
   argv = mkIRExprVec_2(args1[0], oa_event_expr);
   di = unsafeIRDirty_0_N( 2, thisFct, VG_(fnptr_to_fnentry)(f), argv);
-  addStmtToIRSB(sb, IRStmt_Dirty(di));
+  addCheckToIRSB(sb, di, inscon);
 }
 
 static void check_need_call_intrumentation(IRSB* sb, Addr64 cia){
   HChar fnname[COJAC_FCT_LEN];
-  HChar ifname[COJAC_FCT_LEN];
-  if (VG_(get_fnname_if_entry)(cia, fnname, sizeof(fnname))){
+  Call_Cojac_attributes* cca = NULL;
+  ULong t0;
+  if (OA_(options).countOnly) return;  // needs a helper
+  t0 = OA_(stats_enter)(OA_TimeNeedCall);
+  if (OA_(options).siteCache != NULL
+      ? OA_(sitecache_fnname_if_entry)(cia, fnname, sizeof(fnname))
+      : VG_(get_fnname_if_entry)(cia, fnname, sizeof(fnname))){
     int i;
-    for(i = 0; i < OA_CALL_MAX; i++){
-      Call_Cojac_attributes cca = oa_all_call_attr[i];
-      if(cca.callbackI64 == NULL) continue;
-      VG_(strcpy)(ifname, cca.name);
-      if(0 == VG_(strcmp)(fnname, ifname)){
-        switch(cca.paramType){
-          case Call_1xF32: 
-            instrument_Call_1x_F32(sb, cia, cca.call);
-            break;
-          case Call_1xF64: 
-            instrument_Call_1x_F64(sb, cia, cca.call);
-            break;
-          default: break;
-        }
-      }
+    for(i = 0; i < OA_CALL_MAX && cca == NULL; i++){
+      if(oa_all_call_attr[i].callbackI64 == NULL) continue;
+      if(0 == VG_(strcmp)(fnname, oa_all_call_attr[i].name))
+        cca = &oa_all_call_attr[i];
     }
   }
+  OA_(stats_leave)(OA_TimeNeedCall, t0);
+  if (cca == NULL) return;
+  switch(cca->paramType){
+    case Call_1xF32:
+      instrument_Call_1x_F32(sb, cia, cca->call);
+      break;
+    case Call_1xF64:
+      instrument_Call_1x_F64(sb, cia, cca->call);
+      break;
+    default: break;
+  }
+}
+
+// The math functions Cojac knows, watched or not (--site-cache)
+static Bool is_math_call(const HChar* fnname) {
+  int i;
+  for(i = 0; i < OA_CALL_MAX; i++)
+    if(oa_all_call_attr[i].name[0] != '\0'
+       && 0 == VG_(strcmp)(fnname, oa_all_call_attr[i].name))
+      return True;
+  return False;
+}
+
+// The math functions whose entry is instrumented (--site-cache)
+static Bool is_watched_call(const HChar* fnname) {
+  int i;
+  for(i = 0; i < OA_CALL_MAX; i++)
+    if(oa_all_call_attr[i].callbackI64 != NULL
+       && 0 == VG_(strcmp)(fnname, oa_all_call_attr[i].name))
+      return True;
+  return False;
 }
 
 //-----------------------------------------------------------------
 //-----------------------------------------------------------------
 //-----------------------------------------------------------------
+/* The per-thread state of --watch-under, --call-contexts and --batch */
+static void oa_start_client_code(ThreadId tid, ULong blocks_dispatched) {
+  if (OA_(scope_active)())
+    OA_(scope_thread_switch)(tid);
+  if (OA_(options).batch)
+    OA_(batch_thread_switch)(tid);
+  if (OA_(options).callContexts)
+    OA_(callctx_thread_switch)(tid);
+}
+
 static void oa_post_clo_init(void) {
   populate_iop_struct();
   populate_call_struct();
+  OA_(batch_init)();
+  OA_(sites_init)();
+  OA_(groups_init)();
+  if (OA_(options).rangeProfile)
+    OA_(range_init)();
+  if (OA_(options).convertProfile)
+    OA_(convert_init)();
+  if (OA_(options).wastedWork)
+    OA_(waste_init)();
+  if (OA_(options).siteCache != NULL)
+    OA_(sitecache_init)(is_math_call, is_watched_call);
+  if (OA_(options).describeOperands)
+    VG_(needs_var_info)();  // before the debug info of any object is read
+  if (OA_(options).deferredSymbols)
+    VG_(track_die_mem_munmap)(forget_objects);
+  if (OA_(options).callContexts)
+    OA_(callctx_init)();
+  if (OA_(tiers_active)()
+      && (OA_(options).countOnly || OA_(options).batch || OA_(options).fusedOps))
+    VG_(fmsg_bad_option)("--hot-tier",
+                         "Not with --mode=count, --batch or --fusedOps\n");
+  if (OA_(scope_active)() || OA_(options).callContexts || OA_(options).batch)
+    VG_(track_start_client_code)(oa_start_client_code);
   //VG_(message)(Vg_UserMsg, "Nb of ops %d \n", (Iop_Rsqrte32x4-Iop_INVALID));
 }
 
+//-----------------------------------------------------------------
+static const struct {
+  const HChar* name;
+  UInt         kinds;
+} oa_kind_names[] = {
+  { "overflow",     OA_KIND_BIT(Err_Overflow)        },
+  { "cast",         OA_KIND_BIT(Err_Cast)            },
+  { "cancellation", OA_KIND_BIT(Err_Cancellation)    },
+  { "nan",          OA_KIND_BIT(Err_NaN)             },
+  { "inf",          OA_KIND_BIT(Err_Infinity)        },
+  { "precision",    OA_KIND_BIT(Err_Precision)       },
+  { "math",         OA_KIND_BIT(Err_Math)            },
+  { "divbyzero",    OA_KIND_BIT(Err_DivByZero)       },
+  { "underflow",    OA_KIND_BIT(Err_Underflow)       },
+  { "comparison",   OA_KIND_BIT(Err_CloseComparison) },
+  { "subnormal",    OA_KIND_BIT(Err_Subnormal)       },
+  { "all",          OA_ALL_KINDS                     },
+  { "none",         0                                },
+};
+
+/* Parses a comma-separated list of kind names, eg. --kinds=nan,inf */
+static Bool parse_kinds(const HChar* list, UInt* kinds) {
+  HChar  buf[200];
+  HChar* save;
+  HChar* tok;
+  Int    i, n=sizeof(oa_kind_names)/sizeof(oa_kind_names[0]);
+  if (VG_(strlen)(list) >= sizeof(buf)) return False;
+  VG_(strcpy)(buf, list);
+  *kinds = 0;
+  for (tok=VG_(strtok_r)(buf, ",", &save); tok!=NULL; tok=VG_(strtok_r)(NULL, ",", &save)) {
+    for (i=0; i<n; i++)
+      if (VG_STREQ(tok, oa_kind_names[i].name)) break;
+    if (i == n) return False;
+    *kinds |= oa_kind_names[i].kinds;
+  }
+  return True;
+}
+
 static void oa_print_usage(void) {
   VG_(printf)("    --aggr=no|yes  Reports problems even where file/line cannot be determined [no]\n");
   VG_(printf)("    --i16=yes|no   Watch 16bits int operations [yes]\n");
@@ -576,17 +1438,64 @@ static void oa_print_usage(void) {
   VG_(printf)("    --f64=yes|no   Watch 64bits double operations [yes]\n");
   VG_(printf)("    --f64_Ulp_Factor=<number>  Ulp factor for cancellation and comparisons on doubles [4.0]\n");
   VG_(printf)("    --f32_Ulp_Factor=<number>  Ulp factor for cancellation and comparisons on floats [4.0]\n");
+  VG_(printf)("    --castToI32=no|yes    Watch long to int typecasting [no]\n");
   VG_(printf)("    --castToI16=yes|no    Watch int to short typecasting [yes]\n");
+  VG_(printf)("    --castToI8=no|yes     Watch int or short to char typecasting [no]\n");
   VG_(printf)("    --castFromF64=yes|no    Watch float or double to int or long typecasting [yes]\n");
   VG_(printf)("    --stacktrace=<number> Depth of the stacktrace [1] \n");
   VG_(printf)("    --mathStacktrace=<number> Depth of the stacktrace for errors from calls to mathematical functions [2] \n");
   VG_(printf)("    --mathOp=yes|no   Watch for mathematical operations and calls [yes]\n");
+  VG_(printf)("    --batch=no|yes    Check the operations of a superblock in one call (amd64 only) [no]\n");
+  VG_(printf)("    --fusedOps=no|yes Divisions and square roots computed by the checking helper (amd64 only) [no]\n");
+  VG_(printf)("    --kinds=<k1,k2,...>  Error kinds to look for, among overflow, cast, cancellation,\n");
+  VG_(printf)("                         nan, inf, precision, math, divbyzero, underflow, comparison [all]\n");
+  VG_(printf)("                         (no check reports math yet, the math calls report nan, inf...)\n");
+  VG_(printf)("                         and subnormal (not in all: counts the ops with subnormal\n");
+  VG_(printf)("                         operands or results, listed by site at exit)\n");
+  VG_(printf)("    --watch-under=<pattern>  Only check code running (dynamically) under a function\n");
+  VG_(printf)("                             whose name matches the pattern (* and ? allowed) [none]\n");
+  VG_(printf)("    --report-file=<file>  Also write the error sites in a compact format, eg. for\n");
+  VG_(printf)("                          auxprogs/cojac-merge; %%r is the MPI rank, %%p the pid [none]\n");
+  VG_(printf)("    --max-sites=<number>  Only keep the top sites by error count, the others are\n");
+  VG_(printf)("                          summed per function; 0 for no limit [0]\n");
+  VG_(printf)("    --mode=report|count   count: only count the events per site, with inline\n");
+  VG_(printf)("                          counters, and print the sorted counts at exit [report]\n");
+  VG_(printf)("    --range-profile=no|yes  Exponent histograms of the F64 operations, to find\n");
+  VG_(printf)("                          the sites that could be computed in float [no]\n");
+  VG_(printf)("    --conversion-profile=no|yes  Executions of the F32/F64/int conversions per site,\n");
+  VG_(printf)("                          and how many narrow back a value unchanged [no]\n");
+  VG_(printf)("    --wasted-work=no|yes  Fraction of the FP ops of each function that had no\n");
+  VG_(printf)("                          effect (x+0, x-0, x*1, x/1) or were computed on NaN/Inf [no]\n");
+  VG_(printf)("    --cojac-stats=no|yes  Where the time and memory of Cojac itself go: translation,\n");
+  VG_(printf)("                          sampled checks and error handling, contexts [no]\n");
+  VG_(printf)("    --site-cache=<dir>    Keep the debuginfo of the instrumented sites, per object\n");
+  VG_(printf)("                          build-id, in <dir>, for the next runs [none]\n");
+  VG_(printf)("    --call-contexts=no|yes  Shadow call stack: an error is reported once per\n");
+  VG_(printf)("                          calling context, with the stack of the event [no]\n");
+  VG_(printf)("    --describe-operands=no|yes  Name the variables an erroneous operation has read\n");
+  VG_(printf)("                          (reads the DWARF variable info, -g) [no]\n");
+  VG_(printf)("    --symbolize=eager|deferred  deferred: no line lookup when instrumenting, the\n");
+  VG_(printf)("                          code of an object with line info is watched [eager]\n");
+  VG_(printf)("    --hot-tier=none|guard|sample  The superblocks run more than --hot-after times\n");
+  VG_(printf)("                          switch to inline guards, or to sampled\n");
+  VG_(printf)("                          checks; the sites that have reported stay exact [none]\n");
+  VG_(printf)("    --hot-after=<number>  Executions of a superblock before it is hot [10000]\n");
 }
 static void oa_print_debug_usage(void) {
 }
 
 static Bool oa_process_cmd_line_option(const HChar* argv) {
-  if        (VG_BOOL_CLO(argv, "--aggr",       OA_(options).isAggr)) {
+  const HChar* str;
+  if        (VG_STR_CLO(argv, "--kinds", str)) {
+    if (!parse_kinds(str, &OA_(options).kinds))
+      VG_(fmsg_bad_option)(argv, "Unknown error kind in '%s'\n", str);
+    return True;
+  } else if (VG_STR_CLO(argv, "--mode", str)) {
+    if      (VG_(strcmp)(str, "report") == 0) OA_(options).countOnly = False;
+    else if (VG_(strcmp)(str, "count")  == 0) OA_(options).countOnly = True;
+    else VG_(fmsg_bad_option)(argv, "Expected 'report' or 'count'\n");
+    return True;
+  } else if (VG_BOOL_CLO(argv, "--aggr",       OA_(options).isAggr)) {
     return True;
   } else if (VG_INT_CLO(argv, "--stacktrace", OA_(options).stacktraceDepth)) {
     return True;
@@ -608,17 +1517,60 @@ static Bool oa_process_cmd_line_option(const HChar* argv) {
     return True;
   } else if (VG_BOOL_CLO(argv, "--castFromF64", OA_(options).castFromF64)) {
     return True;
+  } else if (VG_BOOL_CLO(argv, "--castToI32", OA_(options).castToI32)) {
+    return True;
   } else if (VG_BOOL_CLO(argv, "--castToI16", OA_(options).castToI16)) {
     return True;
+  } else if (VG_BOOL_CLO(argv, "--castToI8", OA_(options).castToI8)) {
+    return True;
   }  else if (VG_BOOL_CLO(argv, "--mathOp", OA_(options).mathOp)) {
     return True;
+  } else if (VG_BOOL_CLO(argv, "--batch", OA_(options).batch)) {
+    return True;
+  } else if (VG_BOOL_CLO(argv, "--fusedOps", OA_(options).fusedOps)) {
+    return True;
+  } else if (VG_STR_CLO(argv, "--watch-under", OA_(options).watchUnder)) {
+    return True;
+  } else if (VG_STR_CLO(argv, "--report-file", OA_(options).reportFile)) {
+    return True;
+  } else if (VG_BINT_CLO(argv, "--max-sites", OA_(options).maxSites, 0, 10000000)) {
+    return True;
+  } else if (VG_BOOL_CLO(argv, "--range-profile", OA_(options).rangeProfile)) {
+    return True;
+  } else if (VG_BOOL_CLO(argv, "--conversion-profile", OA_(options).convertProfile)) {
+    return True;
+  } else if (VG_BOOL_CLO(argv, "--wasted-work", OA_(options).wastedWork)) {
+    return True;
+  } else if (VG_BOOL_CLO(argv, "--call-contexts", OA_(options).callContexts)) {
+    return True;
+  } else if (VG_BOOL_CLO(argv, "--describe-operands", OA_(options).describeOperands)) {
+    return True;
+  } else if (VG_BOOL_CLO(argv, "--cojac-stats", OA_(options).cojacStats)) {
+    return True;
+  } else if (VG_STR_CLO(argv, "--site-cache", OA_(options).siteCache)) {
+    return True;
+  } else if (VG_STR_CLO(argv, "--symbolize", str)) {
+    if      (VG_(strcmp)(str, "eager")    == 0) OA_(options).deferredSymbols = False;
+    else if (VG_(strcmp)(str, "deferred") == 0) OA_(options).deferredSymbols = True;
+    else VG_(fmsg_bad_option)(argv, "Expected 'eager' or 'deferred'\n");
+    return True;
+  } else if (VG_STR_CLO(argv, "--hot-tier", str)) {
+    if      (VG_(strcmp)(str, "none")   == 0) OA_(options).hotTier = OA_HotNone;
+    else if (VG_(strcmp)(str, "guard")  == 0) OA_(options).hotTier = OA_HotGuard;
+    else if (VG_(strcmp)(str, "sample") == 0) OA_(options).hotTier = OA_HotSample;
+    else VG_(fmsg_bad_option)(argv, "Expected 'none', 'guard' or 'sample'\n");
+    return True;
+  } else if (VG_BINT_CLO(argv, "--hot-after", OA_(options).hotAfter, 1, 1000000000)) {
+    return True;
   }
   return False;
 }
 
 //-----------------------------------------------------------------
 static void oa_set_default_options(void) {
+  OA_(options).castToI32    = False;
   OA_(options).castToI16    = True;
+  OA_(options).castToI8     = False;
   OA_(options).castFromF64  = True;
   OA_(options).Ulp_factor_f64 = 4.0;
   OA_(options).Ulp_factor_f32 = 4.0;
@@ -629,6 +1581,23 @@ static void oa_set_default_options(void) {
   OA_(options).i64          = True;
   OA_(options).mathOp       = True;
   OA_(options).isAggr       = False;
+  OA_(options).batch        = False;
+  OA_(options).fusedOps     = False;
+  OA_(options).kinds        = OA_ALL_KINDS;
+  OA_(options).watchUnder   = NULL;
+  OA_(options).reportFile   = NULL;
+  OA_(options).maxSites     = 0;
+  OA_(options).countOnly    = False;
+  OA_(options).rangeProfile = False;
+  OA_(options).convertProfile = False;
+  OA_(options).wastedWork = False;
+  OA_(options).cojacStats = False;
+  OA_(options).siteCache  = NULL;
+  OA_(options).deferredSymbols = False;
+  OA_(options).describeOperands = False;
+  OA_(options).callContexts = False;
+  OA_(options).hotTier = OA_HotNone;
+  OA_(options).hotAfter = 10000;
   OA_(options).stacktraceDepth = 1;
   OA_(options).stacktraceCallDepth = 2;
 }
@@ -646,6 +1615,7 @@ static IRSB* oa_instrument (VgCallbackClosure* closure,
   IRType     type;
   Addr64     cia; /* address of current insn */
   IRStmt*    st;
+  ULong      t0 = OA_(stats_enter)(OA_TimeInstrument);
 
   if (gWordTy != hWordTy) {
     VG_(tool_panic)("host/guest word size mismatch"); // currently unsupported
@@ -663,6 +1633,13 @@ static IRSB* oa_instrument (VgCallbackClosure* closure,
   }
   st = sbIn->stmts[i];
   cia   = st->Ist.IMark.addr;
+  OA_(group_begin)(closure->nraddr);
+  OA_(tier_begin_SB)();
+  lastObj = NULL;
+  if (OA_(options).siteCache != NULL)
+    OA_(sitecache_begin_SB)(cia);
+  OA_(batch_begin_SB)();
+  OA_(scope_begin_SB)();
   for (/*use current i*/; i < sbIn->stmts_used; i++) {
     st = sbIn->stmts[i];
     if (!st || st->tag == Ist_NoOp) continue;
@@ -671,10 +1648,26 @@ static IRSB* oa_instrument (VgCallbackClosure* closure,
     switch (st->tag) {
       case Ist_IMark:
         cia   = st->Ist.IMark.addr;  
+        OA_(scope_at_IMark)(sbOut, cia, layout, gWordTy);
         check_need_call_intrumentation(sbOut, cia);
         break;
       case Ist_WrTmp:
         // Add a call to trace_load() if --trace-mem=yes.
+        if (OA_(options).countOnly) {
+          if (instrument_count(sbOut, st, cia)) {
+            profile_statement(sbOut, st, cia);
+            continue;  // the statement has been added
+          }
+          break;
+        }
+        if (instrument_fused(sbOut, st, cia)) {
+          profile_statement(sbOut, st, cia);
+          continue;  // the statement has been replaced
+        }
+        if (instrument_guarded(sbOut, st, cia)) {
+          profile_statement(sbOut, st, cia);
+          continue;  // the statement has been added
+        }
         expr = st->Ist.WrTmp.data;
         type = typeOfIRExpr(sbOut->tyenv, expr);
         tl_assert(type != Ity_INVALID);
@@ -690,16 +1683,40 @@ static IRSB* oa_instrument (VgCallbackClosure* closure,
           default: break;
         } // switch
         break;
+      case Ist_Exit:
+        OA_(batch_before_exit)(sbOut, st->Ist.Exit.guard);
+        break;
       default: break;
     } // switch
     addStmtToIRSB( sbOut, st );
+    profile_statement(sbOut, st, cia);
   } // for
+  OA_(batch_end_SB)(sbOut);
+  OA_(scope_end_SB)(sbOut, layout, gWordTy);
+  if (OA_(options).callContexts)
+    OA_(callctx_end_SB)(sbOut, cia, layout, gWordTy);
+  OA_(group_end)();
+  OA_(stats_translation)(sbIn, sbOut);
+  OA_(stats_leave)(OA_TimeInstrument, t0);
   return sbOut;
 }
 
 //-----------------------------------------------------------------
 static void oa_fini(Int exitcode) {
+  OA_(sites_print_counts)();
+  OA_(sites_print_subnormals)();
+  if (OA_(options).rangeProfile)
+    OA_(range_fini)();
+  if (OA_(options).convertProfile)
+    OA_(convert_fini)();
+  if (OA_(options).wastedWork)
+    OA_(waste_fini)();
+  if (OA_(options).cojacStats)
+    OA_(stats_fini)();
+  if (OA_(options).siteCache != NULL)
+    OA_(sitecache_fini)();
   print_instrumentation_stats();
+  OA_(sites_fini)();
 }
 //-----------------------------------------------------------------
 static void oa_pre_clo_init(void) {
@@ -732,6 +1749,10 @@ static void oa_pre_clo_init(void) {
       OA_(get_extra_suppression_use),
       OA_(update_extra_suppression_use)
   );
+#if defined(VG_HAVE_TOOL_ERRORS_HASH)
+  // thousands of distinct error sites are common: no linear search
+  VG_(needs_tool_errors_hash)  (OA_(hash_Error));
+#endif
 
   VG_(needs_command_line_options) (
       oa_process_cmd_line_option,
@@ -739,8 +1760,10 @@ static void oa_pre_clo_init(void) {
       oa_print_debug_usage
   );
 
-  VG_(needs_var_info)();
-  /* No other needs, no core events to track */
+  VG_(needs_superblock_discards) (OA_(discard_superblock_info));
+
+  /* No other needs (var info only with --describe-operands), no core
+   * events to track */
 }
 
 /*--------------------------------------------------------------------*/
@@ -0,0 +1,188 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.           oa_operands ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* Names of the operands of a reported operation (--describe-operands=yes).
+ *
+ * The variables are only known through the DWARF3 variable info, which
+ * the core reads for every object when the tool asks for it; it is thus
+ * asked for (in oa_post_clo_init) only with this option.
+ *
+ * When an operand of a checked operation was loaded from memory in the
+ * same superblock (maybe through the moves of an SSE register), IR
+ * stores before the check save the load addresses, with the context of
+ * the operation. The first time a site reports an error, while the frame
+ * of the operation is live, the addresses are described by the core
+ * (local or global variable, array element, field, declaration line).
+ * Nothing is described for the operands held in registers only, nor with
+ * --batch or --fusedOps.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcbase.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_debuginfo.h"
+#include "pub_tool_mallocfree.h"
+#include "pub_tool_xarray.h"
+#include "oa_include.h"
+
+#define OA_OPERAND_DEPTH 8   // IR moves followed back to the load
+
+static struct {
+  OA_InstrumentContext inscon;  // the last operation that saved addresses
+  Addr addr[2];                 // 0 when not loaded from memory
+} lastOperands;
+
+/*--------------------------------------------------------------------*/
+/* The index of the statement that writes t (before the index from), or
+ * of the last Put to the guest state offset of a Get, or -1 */
+static Int definition(IRSB* sb, Int from, IRExpr* e) {
+  Int i;
+  for (i = from - 1; i >= 0; i--) {
+    IRStmt* st = sb->stmts[i];
+    if (e->tag == Iex_RdTmp && st->tag == Ist_WrTmp
+        && st->Ist.WrTmp.tmp == e->Iex.RdTmp.tmp)
+      return i;
+    if (e->tag == Iex_Get && st->tag == Ist_Put
+        && st->Ist.Put.offset == e->Iex.Get.offset)
+      return i;
+  }
+  return -1;
+}
+
+static Bool is_move(IROp op) {
+  switch (op) {
+    case Iop_64UtoV128: case Iop_32UtoV128:
+    case Iop_V128to64:  case Iop_V128to32:
+    case Iop_ReinterpF64asI64: case Iop_ReinterpI64asF64:
+    case Iop_ReinterpF32asI32: case Iop_ReinterpI32asF32:
+    case Iop_64to32: case Iop_32Uto64: case Iop_32Sto64:
+    case Iop_32to16: case Iop_16Uto32: case Iop_16Sto32:
+      return True;
+    default:
+      return False;
+  }
+}
+
+/* The address expression of the load e comes from, or NULL. A Get of an
+ * SSE register whose low lane has just been Put (movsd from memory) is
+ * followed to that Put: the operations check the low lane. */
+static IRExpr* loaded_from(IRSB* sb, IRExpr* e) {
+  Int d, at = sb->stmts_used;
+  for (d = 0; d < OA_OPERAND_DEPTH; d++) {
+    IRStmt* st;
+    if (e->tag != Iex_RdTmp && e->tag != Iex_Get) return NULL;
+    at = definition(sb, at, e);
+    if (at < 0) return NULL;
+    st = sb->stmts[at];
+    e = st->tag == Ist_Put ? st->Ist.Put.data : st->Ist.WrTmp.data;
+    switch (e->tag) {
+      case Iex_RdTmp:
+      case Iex_Get:
+        break;
+      case Iex_Load:
+        return e->Iex.Load.addr;
+      case Iex_Unop:
+        if (!is_move(e->Iex.Unop.op)) return NULL;
+        e = e->Iex.Unop.arg;
+        break;
+      case Iex_Binop:  // movsd from memory: the low lane is set
+        if (e->Iex.Binop.op != Iop_SetV128lo64 && e->Iex.Binop.op != Iop_SetV128lo32)
+          return NULL;
+        e = e->Iex.Binop.arg2;
+        break;
+      default:
+        return NULL;
+    }
+  }
+  return NULL;
+}
+
+static void save(IRSB* sb, void* where, IRExpr* value) {
+  addStmtToIRSB(sb, IRStmt_Store(Iend_LE, mkIRExpr_HWord((HWord)where), value));
+}
+
+/* Before the check of inscon, whose operands are a1 and a2 (or NULL) */
+void OA_(operands_save)(IRSB* sb, OA_InstrumentContext inscon, IRExpr* a1, IRExpr* a2) {
+  IRExpr* args[2] = { a1, a2 };
+  Int i;
+  for (i = 0; i < 2; i++) {
+    IRExpr* addr = args[i] == NULL ? NULL : loaded_from(sb, args[i]);
+    save(sb, &lastOperands.addr[i], addr != NULL ? addr : mkIRExpr_HWord(0));
+  }
+  save(sb, &lastOperands.inscon, mkIRExpr_HWord((HWord)inscon));
+}
+
+/*--------------------------------------------------------------------*/
+static void append(XArray* xa, const HChar* s) {
+  VG_(addBytesToXA)(xa, s, VG_(strlen)(s));
+}
+
+/* What the variable info says of the operands of inscon, if they have
+ * just been saved: one or two lines in buf (of size n), truncated, or "" */
+void OA_(operands_describe)(OA_InstrumentContext inscon, HChar* buf, Int n) {
+  HChar  thisFct[]="operands_describe";
+  XArray* text;
+  HChar   head[24];
+  Int     i;
+  buf[0] = '\0';
+  if (lastOperands.inscon != inscon) return;
+  text = VG_(newXA)(VG_(malloc), thisFct, VG_(free), sizeof(HChar));
+  for (i = 0; i < 2; i++) {
+    XArray* d1;
+    XArray* d2;
+    if (lastOperands.addr[i] == 0) continue;
+    d1 = VG_(newXA)(VG_(malloc), thisFct, VG_(free), sizeof(HChar));
+    d2 = VG_(newXA)(VG_(malloc), thisFct, VG_(free), sizeof(HChar));
+    if (VG_(get_data_description)(d1, d2, lastOperands.addr[i])
+        && VG_(sizeXA)(d1) > 0) {
+      VG_(sprintf)(head, "   operand %d: ", i + 1);
+      append(text, head);
+      append(text, VG_(indexXA)(d1, 0));
+      if (VG_(sizeXA)(d2) > 0 && *(HChar*)VG_(indexXA)(d2, 0) != '\0') {
+        append(text, "\n      ");
+        append(text, VG_(indexXA)(d2, 0));
+      }
+      append(text, "\n");
+    }
+    VG_(deleteXA)(d1);
+    VG_(deleteXA)(d2);
+  }
+  lastOperands.inscon = NULL;
+  if (VG_(sizeXA)(text) > 0) {
+    Int len = VG_(sizeXA)(text) < n ? VG_(sizeXA)(text) : n - 1;
+    VG_(memcpy)(buf, VG_(indexXA)(text, 0), len);
+    buf[len] = '\0';
+  }
+  VG_(deleteXA)(text);
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
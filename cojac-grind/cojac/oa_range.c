@@ -0,0 +1,336 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.              oa_range ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* Dynamic range profile of the F64 operations (--range-profile=yes).
+ *
+ * Each F64 arithmetic site has two histograms, with one bucket per
+ * (biased) exponent: one for the operands, one for the results. After the
+ * operation, inline IR extracts the exponent of each value and increments
+ * its bucket: the exponent is the index, so there is no branch. Bucket 0
+ * holds the zeros, bucket 2047 the infinities and NaNs. The subnormals go
+ * to bucket 1, with the smallest normals: all are far below the float
+ * range, so a site that sees one is never float-safe.
+ *
+ * For additions and subtractions, the magnitude-bit loss is the larger of
+ * the exponent gap between the operands (the bits of the smaller operand
+ * that are shifted out) and the cancellation depth (how far the result
+ * falls below the larger operand). The maximum is kept per site, updated
+ * with an ITE (a cmov), so still without a branch.
+ *
+ * At exit, a site is "float-safe" if every operand and result is zero,
+ * infinite, NaN or within the normal float range, and its maximum loss
+ * stays below the 24 bits of a float mantissa: the site could then be
+ * computed in float without losing a whole operand or result.
+ *
+ * The sites are keyed by address and never freed, so that retranslated
+ * blocks go on with the same histograms.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "pub_tool_libcbase.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_debuginfo.h"
+#include "pub_tool_hashtable.h"
+#include "pub_tool_mallocfree.h"
+#include "pub_tool_options.h"
+#include "oa_include.h"
+
+/*--------------------------------------------------------------------*/
+#define OA_EXP_BUCKETS  2048
+#define OA_EXP_BIAS     1023
+#define OA_F32_MIN_EXP  (-126 + OA_EXP_BIAS)   // normal float range,
+#define OA_F32_MAX_EXP  ( 127 + OA_EXP_BIAS)   // as biased F64 exponents
+#define OA_F32_BITS     24
+
+typedef struct _OA_RangeSite {
+  struct _OA_RangeSite* next;   // VgHashNode layout
+  UWord        key;             // address
+  const HChar* what;
+  Int          maxLoss;         // bits, additions and subtractions
+  ULong        execs;           // results, computed at exit
+  ULong        operands[OA_EXP_BUCKETS];
+  ULong        results[OA_EXP_BUCKETS];
+} OA_RangeSite;
+
+static VgHashTable rangeSites = NULL;
+
+void OA_(range_init)(void) {
+  rangeSites = VG_(HT_construct)("cojac.range");
+}
+
+static OA_RangeSite* range_site(OA_InstrumentContext ic) {
+  HChar thisFct[]="range_site";
+  OA_RangeSite* s = VG_(HT_lookup)(rangeSites, (UWord)ic->addr);
+  if (s == NULL) {
+    s = VG_(calloc)(thisFct, 1, sizeof(OA_RangeSite));
+    s->key  = (UWord)ic->addr;
+    s->what = ic->string[0] != '\0' ? ic->string : "F64";  // op not registered
+    VG_(HT_add_node)(rangeSites, s);
+  }
+  return s;
+}
+
+/*--------------------------------------------------------------------*/
+static IRExpr* u32(UInt c) {
+  return IRExpr_Const(IRConst_U32(c));
+}
+
+// biased exponent of an F64, as an I32; 1 for a subnormal, 0 for a zero only
+static IRExpr* exponentOf(IRSB* sb, IRExpr* x) {
+  IRExpr* bits = OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(Iop_ReinterpF64asI64, x));
+  IRExpr* hi   = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_64HIto32, bits));
+  IRExpr* sh   = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Shr32, hi,
+                                                       IRExpr_Const(IRConst_U8(20))));
+  IRExpr* e    = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32, sh, u32(OA_EXP_BUCKETS-1)));
+  // subnormal: zero exponent, but some bit set besides the sign
+  IRExpr* mag  = OA_(newTmp)(sb, Ity_I64, IRExpr_Binop(Iop_Shl64, bits,
+                                                       IRExpr_Const(IRConst_U8(1))));
+  IRExpr* nz   = OA_(newTmp)(sb, Ity_I1,  IRExpr_Binop(Iop_CmpNE64, mag,
+                                                       IRExpr_Const(IRConst_U64(0))));
+  IRExpr* ez   = OA_(newTmp)(sb, Ity_I1,  IRExpr_Binop(Iop_CmpEQ32, e, u32(0)));
+  IRExpr* sub  = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32,
+                               OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, nz)),
+                               OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, ez))));
+  return OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Or32, e, sub));
+}
+
+// hist[e] += inc, inc being 1, or the scope guard
+static void bump(IRSB* sb, ULong* hist, IRExpr* e, IRExpr* inc, IRType hWordTy) {
+  IRExpr* off = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Shl32, e,
+                                                      IRExpr_Const(IRConst_U8(3))));
+  IRExpr* addr;
+  if (hWordTy == Ity_I64) {
+    off  = OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(Iop_32Uto64, off));
+    addr = OA_(newTmp)(sb, Ity_I64, IRExpr_Binop(Iop_Add64, mkIRExpr_HWord((HWord)hist), off));
+  } else {
+    addr = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Add32, mkIRExpr_HWord((HWord)hist), off));
+  }
+  OA_(add_at)(sb, addr, inc);
+}
+
+static IRExpr* maxS32(IRSB* sb, IRExpr* a, IRExpr* b) {
+  IRExpr* lt = OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpLT32S, a, b));
+  return OA_(newTmp)(sb, Ity_I32, IRExpr_ITE(lt, b, a));
+}
+
+// 1 when 0 < e < 2047: neither zero, nor infinite/NaN
+static IRExpr* isNormal(IRSB* sb, IRExpr* e) {
+  IRExpr* m = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Sub32, e, u32(1)));
+  IRExpr* c = OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpLT32U, m, u32(OA_EXP_BUCKETS-2)));
+  return OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, c));
+}
+
+// site->maxLoss = max(site->maxLoss, loss of r = a +- b)
+static void update_loss(IRSB* sb, OA_RangeSite* s, IRExpr* ea, IRExpr* eb,
+                        IRExpr* er, IRExpr* scope) {
+  IRExpr* d     = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Sub32, ea, eb));
+  IRExpr* nd    = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Sub32, eb, ea));
+  IRExpr* gap   = maxS32(sb, d, nd);
+  IRExpr* depth = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Sub32, maxS32(sb, ea, eb), er));
+  IRExpr* loss  = maxS32(sb, gap, depth);
+  // only between normal numbers (x-x=0 and x+0 lose nothing in float)
+  IRExpr* ok = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32, isNormal(sb, ea), isNormal(sb, eb)));
+  ok = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32, ok, isNormal(sb, er)));
+  if (scope != NULL) {
+    IRExpr* sc = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, scope));
+    ok = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32, ok, sc));
+  }
+  IRExpr* okBit = OA_(newTmp)(sb, Ity_I1, IRExpr_Unop(Iop_32to1, ok));
+  loss = OA_(newTmp)(sb, Ity_I32, IRExpr_ITE(okBit, loss, u32(0)));
+  IRExpr* addr = mkIRExpr_HWord((HWord)&s->maxLoss);
+  IRExpr* old  = OA_(newTmp)(sb, Ity_I32, IRExpr_Load(Iend_LE, Ity_I32, addr));
+  addStmtToIRSB(sb, IRStmt_Store(Iend_LE, addr, maxS32(sb, old, loss)));
+}
+
+static void profile_lane(IRSB* sb, OA_RangeSite* s, IRExpr* a, IRExpr* b,
+                         IRExpr* r, Bool addSub, IRType hWordTy) {
+  IRExpr* scope = OA_(scope_guard)(sb);
+  IRExpr* inc;
+  if (scope != NULL)
+    inc = OA_(newTmp)(sb, Ity_I64, IRExpr_Unop(Iop_32Uto64,
+                      OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, scope))));
+  else
+    inc = IRExpr_Const(IRConst_U64(1));
+  IRExpr* ea = exponentOf(sb, a);
+  IRExpr* er = exponentOf(sb, r);
+  bump(sb, s->operands, ea, inc, hWordTy);
+  bump(sb, s->results,  er, inc, hWordTy);
+  if (b == NULL) return;
+  IRExpr* eb = exponentOf(sb, b);
+  bump(sb, s->operands, eb, inc, hWordTy);
+  if (addSub)
+    update_loss(sb, s, ea, eb, er, scope);
+}
+
+/* Adds the profiling of the (already added) statement st, if it is
+ * an F64 operation */
+void OA_(range_profile)(IRSB* sb, IRStmt* st, OA_InstrumentContext ic, IRType hWordTy) {
+  IRExpr* e = st->Ist.WrTmp.data;
+  IRExpr* r = IRExpr_RdTmp(st->Ist.WrTmp.tmp);
+  OA_RangeSite* s = range_site(ic);
+  IROp op = ic->op;
+  Bool addSub = (op == Iop_AddF64 || op == Iop_SubF64
+              || op == Iop_Add64F0x2 || op == Iop_Sub64F0x2
+              || op == Iop_Add64Fx2  || op == Iop_Sub64Fx2);
+  switch(op) {
+    case Iop_AddF64: case Iop_SubF64: case Iop_MulF64: case Iop_DivF64:
+      profile_lane(sb, s, e->Iex.Triop.details->arg2, e->Iex.Triop.details->arg3,
+                   r, addSub, hWordTy);
+      break;
+    case Iop_Add64Fx2: case Iop_Sub64Fx2: case Iop_Mul64Fx2: case Iop_Div64Fx2:
+      profile_lane(sb, s, OA_(laneF64)(sb, e->Iex.Binop.arg1, 1), OA_(laneF64)(sb, e->Iex.Binop.arg2, 1),
+                   OA_(laneF64)(sb, r, 1), addSub, hWordTy);
+      // fall through, for the low lane
+    case Iop_Add64F0x2: case Iop_Sub64F0x2: case Iop_Mul64F0x2: case Iop_Div64F0x2:
+      profile_lane(sb, s, OA_(laneF64)(sb, e->Iex.Binop.arg1, 0), OA_(laneF64)(sb, e->Iex.Binop.arg2, 0),
+                   OA_(laneF64)(sb, r, 0), addSub, hWordTy);
+      break;
+    case Iop_Sqrt64Fx2:
+      profile_lane(sb, s, OA_(laneF64)(sb, e->Iex.Unop.arg, 1), NULL, OA_(laneF64)(sb, r, 1),
+                   False, hWordTy);
+      // fall through
+    case Iop_Sqrt64F0x2:
+      profile_lane(sb, s, OA_(laneF64)(sb, e->Iex.Unop.arg, 0), NULL, OA_(laneF64)(sb, r, 0),
+                   False, hWordTy);
+      break;
+    default:
+      break;
+  }
+}
+
+Bool OA_(range_watched)(IROp op) {
+  switch(op) {
+    case Iop_AddF64: case Iop_SubF64: case Iop_MulF64: case Iop_DivF64:
+    case Iop_Add64Fx2: case Iop_Sub64Fx2: case Iop_Mul64Fx2: case Iop_Div64Fx2:
+    case Iop_Add64F0x2: case Iop_Sub64F0x2: case Iop_Mul64F0x2: case Iop_Div64F0x2:
+    case Iop_Sqrt64Fx2: case Iop_Sqrt64F0x2:
+      return True;
+    default:
+      return False;
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Report                                                       ---*/
+/*--------------------------------------------------------------------*/
+
+typedef struct {
+  ULong n;          // values
+  ULong outside;    // nonzero finite values out of the float range
+  Int   min, max;   // of the nonzero finite values, unbiased, max < min if none
+} ExpRange;
+
+static void exp_range(const ULong* hist, ExpRange* er) {
+  Int e;
+  er->n = 0; er->outside = 0; er->min = OA_EXP_BUCKETS; er->max = -OA_EXP_BUCKETS;
+  for (e = 0; e < OA_EXP_BUCKETS; e++) {
+    if (hist[e] == 0) continue;
+    er->n += hist[e];
+    if (e == 0 || e == OA_EXP_BUCKETS-1) continue;
+    if (e < OA_F32_MIN_EXP || e > OA_F32_MAX_EXP) er->outside += hist[e];
+    if (e - OA_EXP_BIAS < er->min) er->min = e - OA_EXP_BIAS;
+    if (e - OA_EXP_BIAS > er->max) er->max = e - OA_EXP_BIAS;
+  }
+}
+
+// the non-empty buckets, with -v
+static void print_hist(const HChar* name, const ULong* hist) {
+  Int e;
+  VG_(umsg)("      %s:", name);
+  for (e = 0; e < OA_EXP_BUCKETS; e++) {
+    if (hist[e] == 0) continue;
+    if (e == 0)                     VG_(umsg)(" 0:%llu", hist[e]);
+    else if (e == 1)                VG_(umsg)(" <=2^-1022:%llu", hist[e]);
+    else if (e == OA_EXP_BUCKETS-1) VG_(umsg)(" inf/nan:%llu", hist[e]);
+    else                            VG_(umsg)(" 2^%d:%llu", e - OA_EXP_BIAS, hist[e]);
+  }
+  VG_(umsg)("\n");
+}
+
+static Int cmp_range_execs(const void* a, const void* b) {
+  const OA_RangeSite* x = *(const OA_RangeSite* const*)a;
+  const OA_RangeSite* y = *(const OA_RangeSite* const*)b;
+  return x->execs < y->execs ? 1 : x->execs > y->execs ? -1 : 0;
+}
+
+static void print_range(const HChar* name, ExpRange* er) {
+  if (er->max < er->min)
+    VG_(umsg)("%s none", name);
+  else
+    VG_(umsg)("%s 2^%d..2^%d", name, er->min, er->max);
+}
+
+void OA_(range_fini)(void) {
+  OA_RangeSite** sorted;
+  UInt i, n, nSafe = 0;
+  if (rangeSites == NULL) return;
+  sorted = (OA_RangeSite**)VG_(HT_to_array)(rangeSites, &n);
+  for (i = 0; i < n; i++) {
+    Int e;
+    for (e = 0; e < OA_EXP_BUCKETS; e++)
+      sorted[i]->execs += sorted[i]->results[e];
+  }
+  VG_(ssort)(sorted, n, sizeof(OA_RangeSite*), cmp_range_execs);
+  VG_(umsg)("Cojac: dynamic range of the F64 sites (float range: 2^%d..2^%d)\n",
+            OA_F32_MIN_EXP - OA_EXP_BIAS, OA_F32_MAX_EXP - OA_EXP_BIAS);
+  for (i = 0; i < n; i++) {
+    OA_RangeSite* s = sorted[i];
+    ExpRange ops, res;
+    HChar fn[COJAC_FCT_LEN];
+    HChar file[COJAC_FILE_LEN];
+    Bool  safe;
+    UInt  lineNo;
+    exp_range(s->operands, &ops);
+    exp_range(s->results, &res);
+    if (res.n == 0) continue;  // never executed
+    safe = ops.outside == 0 && res.outside == 0 && s->maxLoss < OA_F32_BITS;
+    if (safe) nSafe++;
+    OA_(site_location)(s->key, fn, file, &lineNo);
+    VG_(umsg)("  %12llu %s   at %#lx: %s (%s:%u)\n", res.n, s->what, s->key,
+              fn, file, lineNo);
+    print_range("      operands", &ops);
+    print_range(", results", &res);
+    VG_(umsg)(", max loss %d bits: %s\n", s->maxLoss,
+              safe ? "float-safe"
+                   : ops.outside + res.outside > 0 ? "out of float range"
+                                                   : "needs more than 24 bits");
+    if (VG_(clo_verbosity) > 1) {
+      print_hist("operands", s->operands);
+      print_hist("results ", s->results);
+    }
+  }
+  VG_(umsg)("Cojac: %u of the executed F64 sites are float-safe\n", nSafe);
+  VG_(free)(sorted);
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,170 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.              oa_scope ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+
+/* Dynamically scoped checking (--watch-under=<pattern>).
+ *
+ * The checks are only enabled while the running thread is (dynamically)
+ * inside a function whose name matches the pattern, callees included,
+ * whatever object they live in (libm, BLAS...).
+ *
+ * Each thread has a small stack holding the SP at the entry of the
+ * matching functions it is currently in. The entry of such a function
+ * is detected at translation time and gets a call to OA_(scope_enter);
+ * every superblock ending with a return gets a call to OA_(scope_ret)
+ * (guarded by "depth != 0") which pops the frames that have been left.
+ * A longjmp out of the scope is only noticed at the next return.
+ *
+ * The depth of the running thread is mirrored in OA_(scope_depth), so
+ * that the guard of the dirty calls is one load and one compare, done
+ * once per superblock (and again after a scope entry).
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "pub_tool_libcbase.h"
+#include "pub_tool_debuginfo.h"
+#include "pub_tool_seqmatch.h"
+#include "pub_tool_threadstate.h"
+#include "pub_tool_machine.h"     // VG_(fnptr_to_fnentry)
+#include "oa_include.h"
+
+/*--------------------------------------------------------------------*/
+#define OA_SCOPE_MAX 64
+
+typedef struct {
+  Addr sp[OA_SCOPE_MAX];   // SP at the entry of the matching functions
+  UInt depth;
+} OA_ScopeStack;
+
+UInt OA_(scope_depth) = 0;  // depth of the running thread
+
+static OA_ScopeStack  scopeOf[VG_N_THREADS];
+static OA_ScopeStack* curScope = &scopeOf[0];
+
+// translation-time state: temp holding "depth != 0" in the current SB
+static IRTemp curGuard = IRTemp_INVALID;
+
+/*--------------------------------------------------------------------*/
+/*--- Runtime                                                      ---*/
+/*--------------------------------------------------------------------*/
+
+void OA_(scope_thread_switch)(ThreadId tid) {
+  curScope = &scopeOf[tid];
+  OA_(scope_depth) = curScope->depth;
+}
+
+/* Only the outermost matching frame decides whether we are in scope, so
+ * the frames that do not fit (deep recursion) can simply be ignored. */
+VG_REGPARM(1) void OA_(scope_enter)(HWord sp) {
+  if (curScope->depth < OA_SCOPE_MAX)
+    curScope->sp[curScope->depth++] = (Addr)sp;
+  OA_(scope_depth) = curScope->depth;
+}
+
+/* sp is the stack pointer after the return */
+VG_REGPARM(1) void OA_(scope_ret)(HWord sp) {
+  while (curScope->depth > 0 && curScope->sp[curScope->depth-1] < (Addr)sp)
+    curScope->depth--;
+  OA_(scope_depth) = curScope->depth;
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Translation time                                             ---*/
+/*--------------------------------------------------------------------*/
+
+Bool OA_(scope_active)(void) {
+  return OA_(options).watchUnder != NULL;
+}
+
+void OA_(scope_begin_SB)(void) {
+  curGuard = IRTemp_INVALID;
+}
+
+/* At each instruction: the entry of a matching function pushes a frame.
+ * (The entry is not always the first instruction of the SB, VEX may have
+ * chased into the callee.) */
+void OA_(scope_at_IMark)(IRSB* sb, Addr64 cia, VexGuestLayout* layout,
+                         IRType gWordTy) {
+  HChar fnname[COJAC_FCT_LEN];
+  if (!OA_(scope_active)()) return;
+  if (!VG_(get_fnname_if_entry)((Addr)cia, fnname, sizeof(fnname))) return;
+  if (!VG_(string_match)(OA_(options).watchUnder, fnname)) return;
+  IRTemp sp = newIRTemp(sb->tyenv, gWordTy);
+  addStmtToIRSB(sb, IRStmt_WrTmp(sp, IRExpr_Get(layout->offset_SP, gWordTy)));
+  IRDirty* di = unsafeIRDirty_0_N(1, "scope_enter",
+                                  VG_(fnptr_to_fnentry)(OA_(scope_enter)),
+                                  mkIRExprVec_1(IRExpr_RdTmp(sp)));
+  addStmtToIRSB(sb, IRStmt_Dirty(di));
+  curGuard = IRTemp_INVALID;  // the depth has changed
+}
+
+/* The guard to put on the checking dirty calls, NULL when unscoped. */
+IRExpr* OA_(scope_guard)(IRSB* sb) {
+  if (!OA_(scope_active)()) return NULL;
+  if (curGuard == IRTemp_INVALID) {
+    IRTemp depth = newIRTemp(sb->tyenv, Ity_I32);
+    addStmtToIRSB(sb, IRStmt_WrTmp(depth, IRExpr_Load(Iend_LE, Ity_I32,
+                  mkIRExpr_HWord((HWord)&OA_(scope_depth)))));
+    curGuard = newIRTemp(sb->tyenv, Ity_I1);
+    addStmtToIRSB(sb, IRStmt_WrTmp(curGuard, IRExpr_Binop(Iop_CmpNE32,
+                  IRExpr_RdTmp(depth), IRExpr_Const(IRConst_U32(0)))));
+  }
+  return IRExpr_RdTmp(curGuard);
+}
+
+/* The scope guard and'ed with another guard g (either may be NULL) */
+IRExpr* OA_(scope_and_guard)(IRSB* sb, IRExpr* g) {
+  IRExpr* s = OA_(scope_guard)(sb);
+  if (s == NULL) return g;
+  if (g == NULL) return s;
+  IRExpr* s32 = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, s));
+  IRExpr* g32 = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, g));
+  IRExpr* t   = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32, s32, g32));
+  return OA_(newTmp)(sb, Ity_I1, IRExpr_Unop(Iop_32to1, t));
+}
+
+/* At the end of the SB: a return may leave the scope */
+void OA_(scope_end_SB)(IRSB* sb, VexGuestLayout* layout, IRType gWordTy) {
+  if (!OA_(scope_active)()) return;
+  if (sb->jumpkind != Ijk_Ret) return;
+  IRExpr* g = OA_(scope_guard)(sb);
+  IRTemp sp = newIRTemp(sb->tyenv, gWordTy);
+  addStmtToIRSB(sb, IRStmt_WrTmp(sp, IRExpr_Get(layout->offset_SP, gWordTy)));
+  IRDirty* di = unsafeIRDirty_0_N(1, "scope_ret",
+                                  VG_(fnptr_to_fnentry)(OA_(scope_ret)),
+                                  mkIRExprVec_1(IRExpr_RdTmp(sp)));
+  di->guard = g;
+  addStmtToIRSB(sb, IRStmt_Dirty(di));
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
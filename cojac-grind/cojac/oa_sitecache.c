@@ -0,0 +1,487 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.          oa_sitecache ---*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* On-disk site cache (--site-cache=<dir>).
+ *
+ * Each run of the same binary repeats the same debuginfo lookups for the
+ * same code. With this option, what get_debug_info found for an address
+ * (file, line, function, located or not) is kept per mapped object, with
+ * the address as an offset from the object's load bias, and written at
+ * exit in <dir>/<id>.sites; the next runs read the file when the object
+ * is first seen, and only look up the new addresses.
+ *
+ * The object id is its GNU build-id (the NT_GNU_BUILD_ID note, read from
+ * the file), or, without one, its name, size and modification time.
+ *
+ * The math function entries (check_need_call_intrumentation, at every
+ * instruction) are not looked up address by address: the text symbols of
+ * the object named as one of the math functions Cojac knows are listed
+ * once, from its symbol table, and saved with the sites. The list does not
+ * depend on the options, so that runs with other options can share the
+ * file; whether the function is watched in this run is decided at lookup.
+ * An instruction is then a math function entry iff its offset is in that
+ * list and its function is watched.
+ *
+ * The file is line-oriented, tab separated:
+ *
+ *   # cojac-site-cache 2 <object file name>
+ *   S <offset> <line> <located> <function> <file>
+ *   E <offset> <function>
+ *   X                          (the E lines are the complete list)
+ *
+ * A file with another version is ignored, and rewritten at exit.
+ *
+ * Several processes may write the same file: each one writes a temporary
+ * file and renames it, the last one wins.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "pub_tool_libcbase.h"
+#include "pub_tool_libcfile.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_libcproc.h"
+#include "pub_tool_debuginfo.h"
+#include "pub_tool_hashtable.h"
+#include "pub_tool_mallocfree.h"
+#include "pub_tool_options.h"
+#include "pub_tool_vki.h"
+#include "oa_include.h"
+
+/* The few ELF definitions needed to find the build-id note, following
+   the 32/64-bit 'XX' parameterisation of coregrind's readelf.c (tools
+   cannot see the core's <elf.h> types). */
+typedef struct {
+  UChar  e_ident[16];
+  UShort e_type, e_machine;
+  UInt   e_version;
+  UWord  e_entry, e_phoff, e_shoff;
+  UInt   e_flags;
+  UShort e_ehsize, e_phentsize, e_phnum, e_shentsize, e_shnum, e_shstrndx;
+} OA_ElfXX_Ehdr;
+
+#if VG_WORDSIZE == 4
+typedef struct {
+  UInt p_type, p_offset, p_vaddr, p_paddr, p_filesz, p_memsz, p_flags, p_align;
+} OA_ElfXX_Phdr;
+#elif VG_WORDSIZE == 8
+typedef struct {
+  UInt  p_type, p_flags;
+  ULong p_offset, p_vaddr, p_paddr, p_filesz, p_memsz, p_align;
+} OA_ElfXX_Phdr;
+#else
+# error "VG_WORDSIZE should be 4 or 8"
+#endif
+
+typedef struct {
+  UInt n_namesz, n_descsz, n_type;
+} OA_ElfXX_Nhdr;
+
+#define OA_ELFMAG          "\177ELF"
+#define OA_SELFMAG         4
+#define OA_PT_NOTE         4
+#define OA_NT_GNU_BUILD_ID 3
+
+#define OA_ID_LEN 128
+#define OA_CACHE_HEADER "# cojac-site-cache 2 "
+
+typedef struct _OA_CachedSite {
+  struct _OA_CachedSite* next;
+  UWord   offset;            // VgHashNode key
+  UInt    line;
+  Bool    located;
+  HChar*  fn;
+  HChar*  file;
+} OA_CachedSite;
+
+typedef struct _OA_CachedEntry {
+  struct _OA_CachedEntry* next;
+  UWord   offset;            // VgHashNode key
+  HChar*  fn;
+} OA_CachedEntry;
+
+typedef struct _OA_CachedObj {
+  struct _OA_CachedObj* next;
+  const DebugInfo* di;
+  HChar*   filename;
+  Addr     textAvma;
+  SizeT    textSize;
+  PtrdiffT bias;
+  HChar    id[OA_ID_LEN];
+  VgHashTable sites;
+  VgHashTable entries;
+  Bool     scanned;          // entries holds all the math symbols
+  Bool     dirty;            // to be written at exit
+} OA_CachedObj;
+
+static const HChar*  cacheDir = NULL;
+static Bool        (*mathFn)(const HChar* fnname)   = NULL;   // cached
+static Bool        (*wantedFn)(const HChar* fnname) = NULL;   // watched
+static OA_CachedObj* objs   = NULL;
+static OA_CachedObj* curObj = NULL;   // of the current superblock
+static ULong nHits = 0, nMisses = 0, nLoaded = 0;
+
+/*--------------------------------------------------------------------*/
+/*--- Object identity                                              ---*/
+/*--------------------------------------------------------------------*/
+
+static Bool read_at(Int fd, Off64T pos, void* buf, Int len) {
+  if (VG_(lseek)(fd, pos, VKI_SEEK_SET) != pos) return False;
+  return VG_(read)(fd, buf, len) == len;
+}
+
+// The build-id in hex, from the PT_NOTE segments of the ELF file
+static Bool read_build_id(const HChar* filename, HChar id[OA_ID_LEN]) {
+  HChar   notes[4096];
+  OA_ElfXX_Ehdr eh;
+  OA_ElfXX_Phdr ph;
+  SysRes  sres;
+  Int     fd, i;
+  Bool    found = False;
+  sres = VG_(open)(filename, VKI_O_RDONLY, 0);
+  if (sr_isError(sres)) return False;
+  fd = sr_Res(sres);
+  if (!read_at(fd, 0, &eh, sizeof(eh)) || VG_(memcmp)(eh.e_ident, OA_ELFMAG, OA_SELFMAG) != 0) {
+    VG_(close)(fd);
+    return False;
+  }
+  for (i = 0; i < eh.e_phnum && !found; i++) {
+    Int len, pos = 0;
+    if (!read_at(fd, eh.e_phoff + i * eh.e_phentsize, &ph, sizeof(ph))) break;
+    if (ph.p_type != OA_PT_NOTE) continue;
+    len = ph.p_filesz < sizeof(notes) ? ph.p_filesz : sizeof(notes);
+    if (!read_at(fd, ph.p_offset, notes, len)) continue;
+    while (pos + (Int)sizeof(OA_ElfXX_Nhdr) <= len && !found) {
+      OA_ElfXX_Nhdr* nh = (OA_ElfXX_Nhdr*)&notes[pos];
+      Int  name   = pos + sizeof(OA_ElfXX_Nhdr);
+      Int  desc   = name + ((nh->n_namesz + 3) & ~3);
+      UInt descsz = nh->n_descsz;
+      if (desc + descsz > len) break;
+      if (nh->n_type == OA_NT_GNU_BUILD_ID && nh->n_namesz == 4
+          && VG_(memcmp)(&notes[name], "GNU", 4) == 0 && 2*descsz < OA_ID_LEN) {
+        UInt j;
+        for (j = 0; j < descsz; j++)
+          VG_(sprintf)(&id[2*j], "%02x", (UChar)notes[desc+j]);
+        found = True;
+      }
+      pos = desc + ((descsz + 3) & ~3);
+    }
+  }
+  VG_(close)(fd);
+  return found;
+}
+
+static void object_id(const HChar* filename, HChar id[OA_ID_LEN]) {
+  struct vg_stat st;
+  HChar  base[OA_ID_LEN/2];
+  Int    i;
+  if (read_build_id(filename, id)) return;
+  VG_(strncpy)(base, VG_(basename)(filename), sizeof(base)-1);
+  base[sizeof(base)-1] = '\0';
+  for (i = 0; base[i] != '\0'; i++)
+    if (base[i] == '/' || base[i] == ' ' || base[i] == '\t') base[i] = '_';
+  if (sr_isError(VG_(stat)(filename, &st)))
+    st.size = st.mtime = 0;
+  VG_(snprintf)(id, OA_ID_LEN, "%s-%lld-%llu", base, st.size, st.mtime);
+}
+
+static HChar* cache_name(OA_CachedObj* o, const HChar* suffix) {
+  HChar thisFct[]="cache_name";
+  SizeT len = VG_(strlen)(cacheDir) + OA_ID_LEN + 32;
+  HChar* name = VG_(malloc)(thisFct, len);
+  VG_(snprintf)(name, len, "%s/%s.sites%s", cacheDir, o->id, suffix);
+  return name;
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Reading                                                      ---*/
+/*--------------------------------------------------------------------*/
+
+static void add_site(OA_CachedObj* o, UWord offset, UInt line, Bool located,
+                     const HChar* fn, const HChar* file) {
+  HChar thisFct[]="sitecache.site";
+  OA_CachedSite* s = VG_(malloc)(thisFct, sizeof(OA_CachedSite));
+  s->offset  = offset;
+  s->line    = line;
+  s->located = located;
+  s->fn      = VG_(strdup)(thisFct, fn);
+  s->file    = VG_(strdup)(thisFct, file);
+  VG_(HT_add_node)(o->sites, s);
+}
+
+static void add_entry(OA_CachedObj* o, UWord offset, const HChar* fn) {
+  HChar thisFct[]="sitecache.entry";
+  OA_CachedEntry* e = VG_(malloc)(thisFct, sizeof(OA_CachedEntry));
+  e->offset = offset;
+  e->fn     = VG_(strdup)(thisFct, fn);
+  VG_(HT_add_node)(o->entries, e);
+}
+
+// One line, modified in place; False if it is not well-formed
+static Bool parse_line(OA_CachedObj* o, HChar* l) {
+  HChar* f[6];
+  HChar* save;
+  Int    n = 0;
+  if (l[0] == '#' || l[0] == '\0') return True;
+  if (l[0] == 'X' && l[1] == '\0') { o->scanned = True; return True; }
+  while (n < 6 && (f[n] = VG_(strtok_r)(n == 0 ? l : NULL, "\t", &save)) != NULL)
+    n++;
+  if (n == 6 && VG_(strcmp)(f[0], "S") == 0) {
+    add_site(o, VG_(strtoull16)(f[1], NULL), VG_(strtoull10)(f[2], NULL),
+             f[3][0] == '1', f[4], f[5]);
+    return True;
+  }
+  if (n == 3 && VG_(strcmp)(f[0], "E") == 0) {
+    add_entry(o, VG_(strtoull16)(f[1], NULL), f[2]);
+    return True;
+  }
+  return False;
+}
+
+static void load(OA_CachedObj* o) {
+  HChar thisFct[]="sitecache.load";
+  struct vg_stat st;
+  HChar* name = cache_name(o, "");
+  HChar* buf;
+  HChar* l;
+  SysRes sres;
+  Int    fd, i;
+  sres = VG_(open)(name, VKI_O_RDONLY, 0);
+  VG_(free)(name);
+  if (sr_isError(sres)) return;
+  fd = sr_Res(sres);
+  if (VG_(fstat)(fd, &st) != 0 || st.size <= 0) {
+    VG_(close)(fd);
+    return;
+  }
+  buf = VG_(malloc)(thisFct, st.size + 1);
+  if (VG_(read)(fd, buf, st.size) != st.size) {
+    VG_(close)(fd);
+    VG_(free)(buf);
+    return;
+  }
+  VG_(close)(fd);
+  buf[st.size] = '\0';
+  if (VG_(strncmp)(buf, OA_CACHE_HEADER, VG_(strlen)(OA_CACHE_HEADER)) != 0) {
+    VG_(free)(buf);   // another version, or not a site cache
+    return;
+  }
+  for (l = buf, i = 0; i <= st.size; i++) {
+    if (buf[i] != '\n' && buf[i] != '\0') continue;
+    buf[i] = '\0';
+    if (!parse_line(o, l)) {
+      VG_(umsg)("Cojac: ignoring the malformed site cache of %s\n", o->filename);
+      break;   // what has been read so far is kept
+    }
+    l = &buf[i+1];
+  }
+  VG_(free)(buf);
+  nLoaded++;
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Objects                                                      ---*/
+/*--------------------------------------------------------------------*/
+
+static OA_CachedObj* find_obj(Addr a) {
+  HChar thisFct[]="sitecache.obj";
+  const DebugInfo* di = VG_(find_DebugInfo)(a);
+  const HChar* filename;
+  OA_CachedObj* o;
+  if (di == NULL) return NULL;
+  filename = VG_(DebugInfo_get_filename)(di);
+  if (filename == NULL || VG_(DebugInfo_get_text_size)(di) == 0) return NULL;
+  for (o = objs; o != NULL; o = o->next)
+    if (o->di == di && o->textAvma == VG_(DebugInfo_get_text_avma)(di)
+        && VG_(strcmp)(o->filename, filename) == 0)
+      return o;
+  o = VG_(malloc)(thisFct, sizeof(OA_CachedObj));
+  o->di       = di;
+  o->filename = VG_(strdup)(thisFct, filename);
+  o->textAvma = VG_(DebugInfo_get_text_avma)(di);
+  o->textSize = VG_(DebugInfo_get_text_size)(di);
+  o->bias     = VG_(DebugInfo_get_text_bias)(di);
+  o->sites    = VG_(HT_construct)("cojac.sitecache.sites");
+  o->entries  = VG_(HT_construct)("cojac.sitecache.entries");
+  o->scanned  = False;
+  o->dirty    = False;
+  object_id(filename, o->id);
+  load(o);
+  o->next = objs;
+  objs = o;
+  return o;
+}
+
+// The object of a, if it is the one of the current superblock
+static OA_CachedObj* obj_of(Addr a) {
+  if (curObj == NULL) return NULL;
+  if (a < curObj->textAvma || a >= curObj->textAvma + curObj->textSize) return NULL;
+  return curObj;
+}
+
+static void scan_entries(OA_CachedObj* o) {
+  Int i, n = VG_(DebugInfo_syms_howmany)(o->di);
+  for (i = 0; i < n; i++) {
+    Addr   avma, tocptr;
+    UInt   size;
+    HChar* name;
+    HChar** secNames;
+    Bool   isText, isIFunc;
+    VG_(DebugInfo_syms_getidx)(o->di, i, &avma, &tocptr, &size, &name,
+                               &secNames, &isText, &isIFunc);
+    if (isText && mathFn(name) && VG_(HT_lookup)(o->entries, avma - o->bias) == NULL)
+      add_entry(o, avma - o->bias, name);
+  }
+  o->scanned = True;
+  o->dirty = True;
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Interface                                                    ---*/
+/*--------------------------------------------------------------------*/
+
+void OA_(sitecache_init)(Bool (*isMath)(const HChar* fnname),
+                        Bool (*wanted)(const HChar* fnname)) {
+  struct vg_stat st;
+  cacheDir = OA_(options).siteCache;
+  mathFn   = isMath;
+  wantedFn = wanted;
+  if (sr_isError(VG_(stat)(cacheDir, &st)) || !VKI_S_ISDIR(st.mode))
+    VG_(fmsg_bad_option)("--site-cache", "'%s' is not a directory\n", cacheDir);
+}
+
+void OA_(sitecache_begin_SB)(Addr64 addr) {
+  curObj = find_obj((Addr)addr);
+}
+
+Bool OA_(sitecache_debug_info)(Addr a, HChar file[COJAC_FILE_LEN],
+                               HChar fn[COJAC_FCT_LEN], UInt* line, Bool* isLocated) {
+  OA_CachedObj*  o = obj_of(a);
+  OA_CachedSite* s;
+  if (o == NULL) return False;
+  s = VG_(HT_lookup)(o->sites, a - o->bias);
+  if (s == NULL) {
+    nMisses++;
+    return False;
+  }
+  VG_(strncpy)(file, s->file, COJAC_FILE_LEN-1);
+  file[COJAC_FILE_LEN-1] = '\0';
+  VG_(strncpy)(fn, s->fn, COJAC_FCT_LEN-1);
+  fn[COJAC_FCT_LEN-1] = '\0';
+  *line = s->line;
+  *isLocated = s->located;
+  nHits++;
+  return True;
+}
+
+void OA_(sitecache_add)(Addr a, const HChar* file, const HChar* fn, UInt line,
+                        Bool isLocated) {
+  OA_CachedObj* o = obj_of(a);
+  if (o == NULL) return;
+  add_site(o, a - o->bias, line, isLocated, fn, file);
+  o->dirty = True;
+}
+
+/* As VG_(get_fnname_if_entry), for the wanted function names only */
+Bool OA_(sitecache_fnname_if_entry)(Addr a, HChar* fnname, Int n) {
+  OA_CachedObj*   o = obj_of(a);
+  OA_CachedEntry* e;
+  if (o == NULL)
+    return VG_(get_fnname_if_entry)(a, fnname, n) && wantedFn(fnname);
+  if (!o->scanned)
+    scan_entries(o);
+  e = VG_(HT_lookup)(o->entries, a - o->bias);
+  if (e == NULL || !wantedFn(e->fn)) return False;
+  VG_(strncpy)(fnname, e->fn, n-1);
+  fnname[n-1] = '\0';
+  return True;
+}
+
+/*--------------------------------------------------------------------*/
+static void write_line(Int fd, const HChar* l) {
+  VG_(write)(fd, l, VG_(strlen)(l));
+}
+
+static void save(OA_CachedObj* o) {
+  HChar  line[COJAC_FILE_LEN + COJAC_FCT_LEN + 64];
+  HChar  suffix[32];
+  HChar* tmp;
+  HChar* name;
+  SysRes sres;
+  Int    fd;
+  OA_CachedSite*  s;
+  OA_CachedEntry* e;
+  VG_(snprintf)(suffix, sizeof(suffix), ".%d", VG_(getpid)());
+  tmp = cache_name(o, suffix);
+  sres = VG_(open)(tmp, VKI_O_CREAT|VKI_O_WRONLY|VKI_O_TRUNC,
+                   VKI_S_IRUSR|VKI_S_IWUSR|VKI_S_IRGRP|VKI_S_IROTH);
+  if (sr_isError(sres)) {
+    VG_(umsg)("Cojac: cannot create site cache file '%s'\n", tmp);
+    VG_(free)(tmp);
+    return;
+  }
+  fd = sr_Res(sres);
+  VG_(snprintf)(line, sizeof(line), OA_CACHE_HEADER "%s\n", o->filename);
+  write_line(fd, line);
+  VG_(HT_ResetIter)(o->sites);
+  while ((s = VG_(HT_Next)(o->sites)) != NULL) {
+    VG_(snprintf)(line, sizeof(line), "S\t%lx\t%u\t%d\t%s\t%s\n",
+                  s->offset, s->line, s->located ? 1 : 0, s->fn, s->file);
+    write_line(fd, line);
+  }
+  VG_(HT_ResetIter)(o->entries);
+  while ((e = VG_(HT_Next)(o->entries)) != NULL) {
+    VG_(snprintf)(line, sizeof(line), "E\t%lx\t%s\n", e->offset, e->fn);
+    write_line(fd, line);
+  }
+  if (o->scanned)
+    write_line(fd, "X\n");
+  VG_(close)(fd);
+  name = cache_name(o, "");
+  if (VG_(rename)(tmp, name) != 0) {
+    VG_(umsg)("Cojac: cannot rename '%s' to '%s'\n", tmp, name);
+    VG_(unlink)(tmp);
+  }
+  VG_(free)(name);
+  VG_(free)(tmp);
+}
+
+void OA_(sitecache_fini)(void) {
+  OA_CachedObj* o;
+  for (o = objs; o != NULL; o = o->next)
+    if (o->dirty)
+      save(o);
+  if (VG_(clo_verbosity) > 1)
+    VG_(umsg)("Cojac: site cache: %llu objects read, %llu hits, %llu lookups\n",
+              nLoaded, nHits, nMisses);
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
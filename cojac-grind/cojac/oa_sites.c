@@ -0,0 +1,439 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.              oa_sites ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+
+/* Site table: one entry per (code address, error kind) that has raised
+ * an error, with the number of times it did.
+ *
+ * With --report-file=<name>, the table is written at exit in a compact,
+ * line-oriented format (one site per line, tab separated), so that the
+ * reports of many processes (eg. the ranks of an MPI job) can be merged
+ * by auxprogs/cojac-merge:
+ *
+ *   # cojac-sites 1
+ *   # pid <pid> rank <rank>
+ *   <kind> <count> <op> <function> <file>:<line> <address>
+ *
+ * In the file name, %r is replaced by the MPI rank (as found in the
+ * environment of the usual MPI launchers, or the pid if there is none);
+ * %p and %q{VAR} are expanded as for --log-file.
+ *
+ * With --max-sites=N, the table is bounded: it keeps the (approximate)
+ * top-N sites by count with the space-saving algorithm. When a new site
+ * comes in and the table is full, the site with the smallest count is
+ * evicted; its count is folded into the bucket of its function (or of
+ * its object when there is no symbol), and the new site inherits it as
+ * an error bound ("err"). The sites are kept in a min-heap on the count,
+ * so a hit costs O(log N).
+ *
+ * With --mode=count, the count of a site is incremented by the instrumented
+ * code itself (see oa_count.c): the entries are created when the code is
+ * instrumented, the table is not bounded, and it is printed, sorted, at
+ * exit. The counters of the subnormal operations (Err_Subnormal) are kept
+ * the same way in both modes, outside of the bounded heap, and printed
+ * apart as the subnormal hotspots.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "pub_tool_libcbase.h"
+#include "pub_tool_libcfile.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_libcproc.h"
+#include "pub_tool_debuginfo.h"
+#include "pub_tool_hashtable.h"
+#include "pub_tool_mallocfree.h"
+#include "pub_tool_options.h"
+#include "pub_tool_vki.h"
+#include "oa_include.h"
+
+/*--------------------------------------------------------------------*/
+static VgHashTable  sites      = NULL;
+static VgHashTable  buckets    = NULL;  // tail of the bounded table
+static OA_Site**    heap       = NULL;  // min-heap on count, if bounded
+static Int          nSites     = 0;
+static Int          nBuckets   = 0;
+static ULong        nEvicted   = 0;
+static HChar*       reportName = NULL;  // expanded --report-file
+static const HChar* rankStr    = NULL;  // MPI rank, or NULL
+
+// environment variables giving the rank, for the usual MPI launchers
+static const HChar* rankVars[] = {
+  "OMPI_COMM_WORLD_RANK", "PMI_RANK", "PMIX_RANK",
+  "MV2_COMM_WORLD_RANK", "SLURM_PROCID", NULL
+};
+
+static UWord siteKey(Addr addr, ErrorKind kind) {
+  return ((UWord)addr << 4) | (UWord)kind;
+}
+
+typedef struct _OA_Bucket {
+  struct _OA_Bucket* next;   // VgHashNode layout
+  UWord              key;
+  HChar              name[COJAC_FCT_LEN];  // function or object
+  ErrorKind          kind;
+  ULong              count;
+} OA_Bucket;
+
+/*--------------------------------------------------------------------*/
+static const HChar* find_rank(void) {
+  Int i;
+  for (i=0; rankVars[i] != NULL; i++) {
+    HChar* r = VG_(getenv)(rankVars[i]);
+    if (r != NULL && r[0] != '\0') return r;
+  }
+  return NULL;
+}
+
+/* Replaces %r by the rank (or %p), then lets the core expand the rest */
+static HChar* expand_report_name(const HChar* format) {
+  HChar  thisFct[]="expand_report_name";
+  const HChar* rank = rankStr != NULL ? rankStr : "%p";
+  SizeT  n = 0;
+  HChar* buf;
+  HChar* res;
+  Int i, j=0;
+  for (i=0; format[i] != '\0'; i++)
+    if (format[i] == '%' && format[i+1] == 'r') {
+      n++;
+      i++;
+    }
+  buf = VG_(malloc)(thisFct, VG_(strlen)(format) + n * VG_(strlen)(rank) + 1);
+  for (i=0; format[i] != '\0'; i++) {
+    if (format[i] == '%' && format[i+1] == 'r') {
+      VG_(strcpy)(&buf[j], rank);
+      j += VG_(strlen)(rank);
+      i++;
+    } else {
+      buf[j++] = format[i];
+    }
+  }
+  buf[j] = '\0';
+  res = VG_(expand_file_name)("--report-file", buf);
+  VG_(free)(buf);
+  return res;
+}
+
+void OA_(sites_init)(void) {
+  HChar thisFct[]="sites_init";
+  sites = VG_(HT_construct)("cojac.sites");
+  if (OA_(options).maxSites > 0 && !OA_(options).countOnly) {
+    buckets = VG_(HT_construct)("cojac.buckets");
+    heap = VG_(malloc)(thisFct, OA_(options).maxSites * sizeof(OA_Site*));
+  }
+  rankStr = find_rank();
+  if (OA_(options).reportFile != NULL)
+    reportName = expand_report_name(OA_(options).reportFile);
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Bounded table                                                ---*/
+/*--------------------------------------------------------------------*/
+
+static void heap_swap(Int i, Int j) {
+  OA_Site* t = heap[i];
+  heap[i] = heap[j];
+  heap[j] = t;
+  heap[i]->heapIdx = i;
+  heap[j]->heapIdx = j;
+}
+
+static void heap_up(Int i) {
+  while (i > 0 && heap[(i-1)/2]->count > heap[i]->count) {
+    heap_swap(i, (i-1)/2);
+    i = (i-1)/2;
+  }
+}
+
+static void heap_down(Int i) {
+  for (;;) {
+    Int l = 2*i+1, r = l+1, m = i;
+    if (l < nSites && heap[l]->count < heap[m]->count) m = l;
+    if (r < nSites && heap[r]->count < heap[m]->count) m = r;
+    if (m == i) return;
+    heap_swap(i, m);
+    i = m;
+  }
+}
+
+static UWord bucketKey(const HChar* name, ErrorKind kind) {
+  UWord h = 2166136261UL;   // FNV-1a
+  while (*name) { h ^= (UChar)*name++; h *= 16777619UL; }
+  return (h << 4) | (UWord)kind;
+}
+
+/* Adds the count of an evicted site to the bucket of its function */
+static void fold_into_bucket(OA_Site* s) {
+  HChar thisFct[]="fold_into_bucket";
+  HChar name[COJAC_FCT_LEN];
+  OA_Bucket* b;
+  if (!VG_(get_fnname)(s->addr, name, sizeof(name))
+      && !VG_(get_objname)(s->addr, name, sizeof(name)))
+    VG_(strcpy)(name, "???");
+  if (nBuckets >= OA_(options).maxSites)
+    VG_(strcpy)(name, "(other)");   // the tail is bounded as well
+  b = VG_(HT_lookup)(buckets, bucketKey(name, s->kind));
+  if (b == NULL) {
+    b = VG_(malloc)(thisFct, sizeof(OA_Bucket));
+    b->key   = bucketKey(name, s->kind);
+    b->kind  = s->kind;
+    b->count = 0;
+    VG_(strcpy)(b->name, name);
+    VG_(HT_add_node)(buckets, b);
+    nBuckets++;
+  }
+  b->count += s->count - s->err;
+  nEvicted++;
+}
+
+static void init_site(OA_Site* s, UWord key, OA_InstrumentContext ic,
+                      ErrorKind kind, ULong count) {
+  s->key      = key;
+  s->addr     = ic->addr;
+  s->what     = ic->string;
+  s->kind     = kind;
+  s->count    = count;
+  s->err      = count;
+  s->reported = False;
+}
+
+static OA_Site* bounded_site_hit(UWord key, OA_InstrumentContext ic,
+                                 ErrorKind kind) {
+  HChar thisFct[]="bounded_site_hit";
+  OA_Site* s = VG_(HT_lookup)(sites, key);
+  if (s != NULL) {
+    s->count++;
+    heap_down(s->heapIdx);
+    return s;
+  }
+  if (nSites < OA_(options).maxSites) {
+    s = VG_(malloc)(thisFct, sizeof(OA_Site));
+    init_site(s, key, ic, kind, 0);
+    s->heapIdx = nSites;
+    heap[nSites++] = s;
+  } else {
+    // space-saving: the new site replaces the smallest one
+    s = heap[0];
+    fold_into_bucket(s);
+    VG_(HT_remove)(sites, s->key);
+    init_site(s, key, ic, kind, s->count);
+  }
+  VG_(HT_add_node)(sites, s);
+  s->count++;
+  heap_down(s->heapIdx);
+  heap_up(s->heapIdx);
+  return s;
+}
+
+/*--------------------------------------------------------------------*/
+OA_Site* OA_(site_hit)(OA_InstrumentContext ic, ErrorKind kind) {
+  HChar thisFct[]="site_hit";
+  UWord key = siteKey(ic->addr, kind);
+  OA_Site* s;
+  if (heap != NULL)
+    return bounded_site_hit(key, ic, kind);
+  s = VG_(HT_lookup)(sites, key);
+  if (s == NULL) {
+    s = VG_(malloc)(thisFct, sizeof(OA_Site));
+    init_site(s, key, ic, kind, 0);
+    VG_(HT_add_node)(sites, s);
+  }
+  s->count++;
+  return s;
+}
+
+/* --mode=count: the counter of a site, for the instrumented code */
+ULong* OA_(site_counter)(OA_InstrumentContext ic, ErrorKind kind) {
+  HChar thisFct[]="site_counter";
+  UWord key = siteKey(ic->addr, kind);
+  OA_Site* s = VG_(HT_lookup)(sites, key);
+  if (s == NULL) {
+    s = VG_(malloc)(thisFct, sizeof(OA_Site));
+    init_site(s, key, ic, kind, 0);
+    VG_(HT_add_node)(sites, s);
+  }
+  return &s->count;
+}
+
+/* --hot-tier: whether an error of any kind has been reported at addr
+ * (a site evicted with --max-sites is forgotten) */
+Bool OA_(site_reported)(Addr addr) {
+  OA_Site* s;
+  ErrorKind k;
+  for (k = Err_Overflow; k < Err_Subnormal; k++) {
+    s = VG_(HT_lookup)(sites, siteKey(addr, k));
+    if (s != NULL && s->reported) return True;
+  }
+  return False;
+}
+
+/*--------------------------------------------------------------------*/
+static void write_site(Int fd, OA_Site* s) {
+  HChar fn[COJAC_FCT_LEN];
+  HChar file[COJAC_FILE_LEN];
+  HChar line[COJAC_FILE_LEN + COJAC_FCT_LEN + 100];
+  UInt  lineNo;
+  if (s->count == 0) return;  // --mode=count, never hit
+  OA_(site_location)(s->addr, fn, file, &lineNo);
+  VG_(snprintf)(line, sizeof(line), "%s\t%llu\t%s\t%s\t%s:%u\t%#lx\n",
+                OA_(strFromErrorKind)(s->kind), s->count, s->what,
+                fn, file, lineNo, s->addr);
+  VG_(write)(fd, line, VG_(strlen)(line));
+}
+
+static void write_report(void) {
+  HChar   header[100];
+  SysRes  sres;
+  Int     fd;
+  OA_Site* s;
+  sres = VG_(open)(reportName, VKI_O_CREAT|VKI_O_WRONLY|VKI_O_TRUNC,
+                   VKI_S_IRUSR|VKI_S_IWUSR|VKI_S_IRGRP|VKI_S_IROTH);
+  if (sr_isError(sres)) {
+    VG_(umsg)("Cojac: cannot create report file '%s'\n", reportName);
+    return;
+  }
+  fd = sr_Res(sres);
+  VG_(snprintf)(header, sizeof(header), "# cojac-sites 1\n# pid %d rank %s\n",
+                VG_(getpid)(), rankStr != NULL ? rankStr : "-");
+  VG_(write)(fd, header, VG_(strlen)(header));
+  VG_(HT_ResetIter)(sites);
+  while ((s = VG_(HT_Next)(sites)) != NULL)
+    if (s->kind != Err_Subnormal)
+      write_site(fd, s);
+  if (buckets != NULL) {
+    OA_Bucket* b;
+    HChar line[COJAC_FCT_LEN + 100];
+    VG_(HT_ResetIter)(buckets);
+    while ((b = VG_(HT_Next)(buckets)) != NULL) {
+      VG_(snprintf)(line, sizeof(line), "%s\t%llu\t(tail)\t%s\t???:0\t0x0\n",
+                    OA_(strFromErrorKind)(b->kind), b->count, b->name);
+      VG_(write)(fd, line, VG_(strlen)(line));
+    }
+  }
+  // the performance events apart, after the errors
+  if (OA_KIND_ON(Err_Subnormal)) {
+    const HChar* title = "# subnormal hotspots\n";
+    VG_(write)(fd, title, VG_(strlen)(title));
+    VG_(HT_ResetIter)(sites);
+    while ((s = VG_(HT_Next)(sites)) != NULL)
+      if (s->kind == Err_Subnormal)
+        write_site(fd, s);
+  }
+  VG_(close)(fd);
+}
+
+static Int cmp_site_count(const void* a, const void* b) {
+  const OA_Site* x = *(const OA_Site* const*)a;
+  const OA_Site* y = *(const OA_Site* const*)b;
+  return x->count < y->count ? 1 : x->count > y->count ? -1 : 0;
+}
+
+/* The summary of the bounded table: the top sites, then the tail */
+static void print_top_sites(void) {
+  OA_Site** sorted;
+  OA_Bucket* b;
+  UInt i, n;
+  if (heap == NULL || nSites == 0) return;
+  n = nSites;  // the heap, without the subnormal counters
+  sorted = VG_(malloc)("print_top_sites", n * sizeof(OA_Site*));
+  VG_(memcpy)(sorted, heap, n * sizeof(OA_Site*));
+  VG_(ssort)(sorted, n, sizeof(OA_Site*), cmp_site_count);
+  VG_(umsg)("Cojac: top %u error sites (%llu evicted into %d buckets)\n",
+            n, nEvicted, nBuckets);
+  for (i=0; i<n; i++) {
+    HChar fn[COJAC_FCT_LEN];
+    if (!VG_(get_fnname)(sorted[i]->addr, fn, sizeof(fn)))
+      VG_(strcpy)(fn, "???");
+    VG_(umsg)("  %12llu (+-%llu) %s, %s at %#lx: %s\n", sorted[i]->count,
+              sorted[i]->err, OA_(strFromErrorKind)(sorted[i]->kind),
+              sorted[i]->what, sorted[i]->addr, fn);
+  }
+  VG_(free)(sorted);
+  VG_(HT_ResetIter)(buckets);
+  while ((b = VG_(HT_Next)(buckets)) != NULL)
+    VG_(umsg)("  %12llu tail %s in %s\n", b->count,
+              OA_(strFromErrorKind)(b->kind), b->name);
+}
+
+static void print_site(OA_Site* s, Bool withKind) {
+  HChar fn[COJAC_FCT_LEN];
+  HChar file[COJAC_FILE_LEN];
+  UInt  lineNo;
+  OA_(site_location)(s->addr, fn, file, &lineNo);
+  if (withKind)
+    VG_(umsg)("  %12llu %s, %s   at %#lx: %s (%s:%u)\n", s->count,
+              OA_(strFromErrorKind)(s->kind), s->what, s->addr, fn, file, lineNo);
+  else
+    VG_(umsg)("  %12llu %s   at %#lx: %s (%s:%u)\n", s->count,
+              s->what, s->addr, fn, file, lineNo);
+}
+
+/* --mode=count: all the sites that were hit, by decreasing count */
+void OA_(sites_print_counts)(void) {
+  OA_Site** sorted;
+  UInt i, n;
+  if (!OA_(options).countOnly) return;
+  sorted = (OA_Site**)VG_(HT_to_array)(sites, &n);
+  VG_(ssort)(sorted, n, sizeof(OA_Site*), cmp_site_count);
+  VG_(umsg)("Cojac: event counts by site\n");
+  for (i=0; i<n && sorted[i]->count > 0; i++)
+    if (sorted[i]->kind != Err_Subnormal)
+      print_site(sorted[i], True);
+  VG_(free)(sorted);
+}
+
+/* --kinds=...,subnormal: the sites of the ops with subnormal operands or
+ * results, by decreasing count */
+void OA_(sites_print_subnormals)(void) {
+  OA_Site** sorted;
+  UInt  i, n;
+  ULong total = 0;
+  if (!OA_KIND_ON(Err_Subnormal)) return;
+  sorted = (OA_Site**)VG_(HT_to_array)(sites, &n);
+  VG_(ssort)(sorted, n, sizeof(OA_Site*), cmp_site_count);
+  VG_(umsg)("Cojac: subnormal hotspots (ops with a subnormal operand or result)\n");
+  for (i=0; i<n && sorted[i]->count > 0; i++) {
+    if (sorted[i]->kind != Err_Subnormal) continue;
+    print_site(sorted[i], False);
+    total += sorted[i]->count;
+  }
+  VG_(umsg)("  %12llu in total\n", total);
+  VG_(free)(sorted);
+}
+
+void OA_(sites_fini)(void) {
+  print_top_sites();
+  if (reportName != NULL)
+    write_report();
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,217 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.              oa_stats ---*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* Overhead self-profiling (--cojac-stats=yes), in the spirit of the
+ * core's --stats=yes: where does Cojac itself spend its time and memory?
+ *
+ * - translation: every call of oa_instrument is timed (rdtsc ticks),
+ *   and so are the debuginfo lookups and check_need_call_intrumentation
+ *   within it; the rest is IR emission. The IR added to each superblock
+ *   is counted (statements, temporaries, dirty calls).
+ * - run time: the checking calls emitted by addCheckToIRSB are counted
+ *   inline, and one in OA_STATS_PERIOD is framed by two small dirty
+ *   calls, which time it. OA_(maybe_error) and VG_(maybe_record_error)
+ *   are sampled as well, in their own code.
+ * - memory: the instrumentation contexts and the error extras kept by
+ *   the core.
+ *
+ * Every check pays for the inline counter, only the sampled ones for the
+ * framing calls; the sampled ticks include neither. Without the option,
+ * nothing is emitted and the timers return at once.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "pub_tool_libcbase.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_machine.h"     // VG_(fnptr_to_fnentry)
+#include "oa_include.h"
+
+#define OA_STATS_PERIOD 64   // one run-time sample every ... calls
+
+typedef struct {
+  UInt  period;    // 1: every call is timed
+  ULong calls;
+  ULong sampled;
+  ULong ticks;     // of the sampled calls
+} OA_Timer;
+
+static OA_Timer timers[OA_TimeMAX] = {
+  [OA_TimeInstrument]  = { 1 },
+  [OA_TimeDebugInfo]   = { 1 },
+  [OA_TimeNeedCall]    = { 1 },
+  [OA_TimeCheck]       = { OA_STATS_PERIOD },  // sampled inline
+  [OA_TimeMaybeError]  = { OA_STATS_PERIOD },
+  [OA_TimeRecordError] = { OA_STATS_PERIOD },
+};
+
+static ULong nSBs        = 0;
+static ULong stmtsIn     = 0;
+static ULong stmtsOut    = 0;
+static ULong tmpsAdded   = 0;
+static ULong dirtyCalls  = 0;  // emitted, the framing calls excluded
+static ULong maxDirty    = 0;  // in one superblock
+static ULong framedInSB  = 0;  // checks framed in the current superblock
+static ULong extrasKept  = 0;
+static ULong extrasBytes = 0;
+static ULong checkCalls  = 0;  // incremented by the instrumented code
+static ULong checkStart  = 0;
+
+static __inline__ ULong rdtsc(void) {
+#if defined(VGA_x86) || defined(VGA_amd64)
+  UInt lo, hi;
+  __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((ULong)hi << 32) | lo;
+#else
+  return 0;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+ULong OA_(stats_enter)(OA_StatsTimer t) {
+  if (!OA_(options).cojacStats) return 0;
+  if (++timers[t].calls % timers[t].period != 0) return 0;
+  return rdtsc();
+}
+
+void OA_(stats_leave)(OA_StatsTimer t, ULong start) {
+  if (start == 0) return;
+  timers[t].ticks += rdtsc() - start;
+  timers[t].sampled++;
+}
+
+/*--------------------------------------------------------------------*/
+/* The framing of the sampled checks, called from the instrumented code */
+
+static void check_enter(void) {
+  checkStart = rdtsc();
+}
+
+static void check_leave(void) {
+  OA_(stats_leave)(OA_TimeCheck, checkStart);
+}
+
+static void add_frame(IRSB* sb, IRExpr* guard, const HChar* name, void* fn) {
+  IRDirty* di = unsafeIRDirty_0_N(0, name, VG_(fnptr_to_fnentry)(fn), mkIRExprVec_0());
+  if (guard != NULL)
+    di->guard = guard;
+  addStmtToIRSB(sb, IRStmt_Dirty(di));
+}
+
+/* Adds the checking call di. With --cojac-stats=yes, checkCalls counts
+ * it inline, and it is framed by the timing calls when the count is a
+ * multiple of OA_STATS_PERIOD */
+void OA_(stats_add_check)(IRSB* sb, IRDirty* di) {
+  IRExpr *b, *n, *low, *z, *s, *sampled;
+  if (!OA_(options).cojacStats) {
+    addStmtToIRSB(sb, IRStmt_Dirty(di));
+    return;
+  }
+  // same guard: a check skipped by --watch-under is not counted
+  b = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, di->guard));
+  OA_(add_bit)(sb, &checkCalls, b);
+  n   = OA_(newTmp)(sb, Ity_I64, IRExpr_Load(Iend_LE, Ity_I64,
+                                             mkIRExpr_HWord((HWord)&checkCalls)));
+  low = OA_(newTmp)(sb, Ity_I64, IRExpr_Binop(Iop_And64, n,
+                                 IRExpr_Const(IRConst_U64(OA_STATS_PERIOD - 1))));
+  z   = OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpEQ64, low,
+                                             IRExpr_Const(IRConst_U64(0))));
+  z   = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, z));
+  s   = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32, z, b));
+  sampled = OA_(newTmp)(sb, Ity_I1, IRExpr_Unop(Iop_32to1, s));
+  add_frame(sb, sampled, "check_enter", check_enter);
+  addStmtToIRSB(sb, IRStmt_Dirty(di));
+  add_frame(sb, sampled, "check_leave", check_leave);
+  framedInSB++;
+}
+
+/*--------------------------------------------------------------------*/
+static Int dirty_calls(IRSB* sb) {
+  Int i, n = 0;
+  for (i = 0; i < sb->stmts_used; i++)
+    if (sb->stmts[i]->tag == Ist_Dirty) n++;
+  return n;
+}
+
+/* At the end of oa_instrument: what has been added to sbIn */
+void OA_(stats_translation)(IRSB* sbIn, IRSB* sbOut) {
+  ULong added;
+  if (!OA_(options).cojacStats) return;
+  added = dirty_calls(sbOut) - dirty_calls(sbIn) - 2*framedInSB;
+  nSBs++;
+  stmtsIn   += sbIn->stmts_used;
+  stmtsOut  += sbOut->stmts_used;
+  tmpsAdded += sbOut->tyenv->types_used - sbIn->tyenv->types_used;
+  dirtyCalls += added;
+  if (added > maxDirty) maxDirty = added;
+  framedInSB = 0;
+}
+
+/* An error extra copied by the core, which keeps it until the end */
+void OA_(stats_extra_alloc)(SizeT size) {
+  extrasKept++;
+  extrasBytes += size;
+}
+
+/*--------------------------------------------------------------------*/
+static ULong perCall(OA_StatsTimer t) {
+  return timers[t].sampled == 0 ? 0 : timers[t].ticks / timers[t].sampled;
+}
+
+void OA_(stats_fini)(void) {
+  HChar b1[8], b2[8], b3[8];
+  ULong total  = timers[OA_TimeInstrument].ticks;
+  ULong lookup = timers[OA_TimeDebugInfo].ticks;
+  ULong need   = timers[OA_TimeNeedCall].ticks;
+  ULong emit   = total > lookup + need ? total - lookup - need : 0;
+  ULong added  = stmtsOut - stmtsIn;
+
+  VG_(umsg)("Cojac: overhead statistics (ticks are rdtsc cycles)\n");
+  VG_(umsg)("  translation: %llu superblocks, %llu ticks in oa_instrument (%llu per SB)\n",
+            nSBs, total, nSBs == 0 ? 0 : total / nSBs);
+  VG_(umsg)("               %s debuginfo lookup, %s check_need_call_intrumentation, %s IR emission\n",
+            OA_(percent)(lookup, total, b1), OA_(percent)(need, total, b2), OA_(percent)(emit, total, b3));
+  VG_(umsg)("               %llu dirty calls emitted (%llu per SB, at most %llu)\n",
+            dirtyCalls, nSBs == 0 ? 0 : dirtyCalls / nSBs, maxDirty);
+  VG_(umsg)("               %llu IR statements and %llu temporaries added (~%llu bytes)\n",
+            added, tmpsAdded,
+            added * (sizeof(IRStmt) + sizeof(IRExpr)) + tmpsAdded * sizeof(IRType));
+  VG_(umsg)("  run time:    %llu checks, ~%llu ticks each (1 in %d timed)\n",
+            checkCalls, perCall(OA_TimeCheck), OA_STATS_PERIOD);
+  VG_(umsg)("               %llu calls of OA_(maybe_error), ~%llu ticks each\n",
+            timers[OA_TimeMaybeError].calls, perCall(OA_TimeMaybeError));
+  VG_(umsg)("               %llu calls of VG_(maybe_record_error), ~%llu ticks each\n",
+            timers[OA_TimeRecordError].calls, perCall(OA_TimeRecordError));
+  VG_(umsg)("  memory:      %llu bytes of contexts, %llu error extras kept (%llu bytes)\n",
+            OA_(groups_context_bytes)(), extrasKept, extrasBytes);
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,169 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.               oa_tier ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+
+/* Tiered instrumentation (--hot-tier=guard|sample).
+ *
+ * A superblock is translated once, with both tiers: its first check
+ * increments a counter of the translation, and the superblock is hot,
+ * for that execution, when the counter is above --hot-after. Each check
+ * is guarded by this inline flag, so that nothing is translated again:
+ *
+ * - guard: the operations that oa_count.c has predicates for keep their
+ *   exact check in the cold executions only; in the hot ones, the
+ *   predicates guard a report, and no helper is called while nothing
+ *   goes wrong. Cancellations and close comparisons are no more looked
+ *   for once the superblock is hot.
+ * - sample: the exact checks, in the cold executions, then on one hot
+ *   execution in OA_HOT_SAMPLE.
+ *
+ * The sites that had already reported when the superblock was translated
+ * keep their exact checks, and so do the calls of the math functions.
+ * The counter wraps after 2^32 executions, which only gives back the
+ * exact checks for a while. It is owned by the group of the translation
+ * (see oa_groups.c).
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_mallocfree.h"
+#include "oa_include.h"
+
+/*--------------------------------------------------------------------*/
+#define OA_HOT_SAMPLE 64   // a power of 2
+
+static ULong nCounted = 0;   // translations with a counter
+
+// translation-time state
+static IRTemp curCount  = IRTemp_INVALID;  // the counter, incremented
+static IRTemp curHot    = IRTemp_INVALID;  // "count > hotAfter"
+static IRTemp curCold   = IRTemp_INVALID;
+static IRTemp curSample = IRTemp_INVALID;  // cold, or "count % OA_HOT_SAMPLE == 0"
+static Bool   curPredicated = False;       // the check has hot predicates
+
+/*--------------------------------------------------------------------*/
+Bool OA_(tiers_active)(void) {
+  return OA_(options).hotTier != OA_HotNone;
+}
+
+void OA_(tier_begin_SB)(void) {
+  curCount  = IRTemp_INVALID;
+  curHot    = IRTemp_INVALID;
+  curCold   = IRTemp_INVALID;
+  curSample = IRTemp_INVALID;
+  curPredicated = False;
+}
+
+/* The counter of the translation, incremented at the first check, and
+ * the hot and cold flags of this execution */
+static void count_SB(IRSB* sb) {
+  HChar thisFct[]="tier_count";
+  UInt*  c;
+  IRTemp old, h;
+  if (curCount != IRTemp_INVALID) return;
+  c = VG_(malloc)(thisFct, sizeof(UInt));
+  *c = 0;
+  OA_(group_own)(c);
+  nCounted++;
+  old = newIRTemp(sb->tyenv, Ity_I32);
+  addStmtToIRSB(sb, IRStmt_WrTmp(old, IRExpr_Load(Iend_LE, Ity_I32,
+                mkIRExpr_HWord((HWord)c))));
+  curCount = newIRTemp(sb->tyenv, Ity_I32);
+  addStmtToIRSB(sb, IRStmt_WrTmp(curCount, IRExpr_Binop(Iop_Add32,
+                IRExpr_RdTmp(old), IRExpr_Const(IRConst_U32(1)))));
+  addStmtToIRSB(sb, IRStmt_Store(Iend_LE, mkIRExpr_HWord((HWord)c),
+                IRExpr_RdTmp(curCount)));
+  curHot = newIRTemp(sb->tyenv, Ity_I1);
+  addStmtToIRSB(sb, IRStmt_WrTmp(curHot, IRExpr_Binop(Iop_CmpLT32U,
+                IRExpr_Const(IRConst_U32((UInt)OA_(options).hotAfter)),
+                IRExpr_RdTmp(curCount))));
+  h = newIRTemp(sb->tyenv, Ity_I32);
+  addStmtToIRSB(sb, IRStmt_WrTmp(h, IRExpr_Unop(Iop_1Uto32, IRExpr_RdTmp(curHot))));
+  curCold = newIRTemp(sb->tyenv, Ity_I1);
+  addStmtToIRSB(sb, IRStmt_WrTmp(curCold, IRExpr_Binop(Iop_CmpEQ32,
+                IRExpr_RdTmp(h), IRExpr_Const(IRConst_U32(0)))));
+}
+
+/* With --hot-tier=guard: whether the next exact checks have predicates
+ * for the hot executions (they are then only made in the cold ones) */
+void OA_(tier_predicated)(Bool predicated) {
+  curPredicated = predicated;
+}
+
+/* Whether this execution of the superblock is hot: the guard of the
+ * predicates of --hot-tier=guard */
+IRExpr* OA_(tier_hot)(IRSB* sb) {
+  count_SB(sb);
+  return IRExpr_RdTmp(curHot);
+}
+
+/* The guard to put on the exact check of ic (the scope guard apart), or
+ * NULL when it is made in every execution */
+IRExpr* OA_(tier_guard)(IRSB* sb, OA_InstrumentContext ic) {
+  IRTemp low, zero, cold, sampled, s;
+  if (!OA_(tiers_active)() || ic->type == IsCall) return NULL;
+  if (OA_(options).hotTier == OA_HotGuard) {
+    if (!curPredicated) return NULL;
+    count_SB(sb);
+    return IRExpr_RdTmp(curCold);
+  }
+  if (OA_(site_reported)(ic->addr)) return NULL;
+  if (curSample == IRTemp_INVALID) {
+    count_SB(sb);
+    low = newIRTemp(sb->tyenv, Ity_I32);
+    addStmtToIRSB(sb, IRStmt_WrTmp(low, IRExpr_Binop(Iop_And32,
+                  IRExpr_RdTmp(curCount),
+                  IRExpr_Const(IRConst_U32(OA_HOT_SAMPLE - 1)))));
+    zero = newIRTemp(sb->tyenv, Ity_I1);
+    addStmtToIRSB(sb, IRStmt_WrTmp(zero, IRExpr_Binop(Iop_CmpEQ32,
+                  IRExpr_RdTmp(low), IRExpr_Const(IRConst_U32(0)))));
+    cold = newIRTemp(sb->tyenv, Ity_I32);
+    addStmtToIRSB(sb, IRStmt_WrTmp(cold, IRExpr_Unop(Iop_1Uto32, IRExpr_RdTmp(curCold))));
+    sampled = newIRTemp(sb->tyenv, Ity_I32);
+    addStmtToIRSB(sb, IRStmt_WrTmp(sampled, IRExpr_Unop(Iop_1Uto32, IRExpr_RdTmp(zero))));
+    s = newIRTemp(sb->tyenv, Ity_I32);
+    addStmtToIRSB(sb, IRStmt_WrTmp(s, IRExpr_Binop(Iop_Or32,
+                  IRExpr_RdTmp(cold), IRExpr_RdTmp(sampled))));
+    curSample = newIRTemp(sb->tyenv, Ity_I1);
+    addStmtToIRSB(sb, IRStmt_WrTmp(curSample, IRExpr_Unop(Iop_32to1, IRExpr_RdTmp(s))));
+  }
+  return IRExpr_RdTmp(curSample);
+}
+
+void OA_(tier_print_stats)(void) {
+  if (!OA_(tiers_active)()) return;
+  VG_(umsg)("    hot tier: %llu superblocks counted, hot after %d executions\n",
+            nCounted, OA_(options).hotAfter);
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
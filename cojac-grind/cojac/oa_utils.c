@@ -36,7 +36,7 @@
 
 
 //------------- 64 <--> 64
-static ULong longFromDouble(Double d) {
+ULong OA_(ulongFromDouble)(Double d) {
   oa_mix64_t m;
   m.f=d;
   return m.u;
@@ -91,7 +91,7 @@ double OA_(doubleFromTwoInts)(Int a, Int b) {
   return doubleFromTwoUInts(OA_(uintFromInt)(a), OA_(uintFromInt)(b));
 }
 static void doubleToTwoUInts(double d, UInt *a, UInt *b) {
-  longToTwoUInts(longFromDouble(d), a, b);
+  longToTwoUInts(OA_(ulongFromDouble)(d), a, b);
 }
 static void doubleToTwoInts(double d, Int *a, Int *b) {
   UInt ua, ub;
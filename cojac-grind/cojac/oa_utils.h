@@ -79,6 +79,7 @@ Short  OA_(shortFromInt)(Int i);
 double OA_(doubleFromTwoInts)(Int a, Int b);
 void   OA_(longToTwoInts)(ULong d, Int *a, Int *b);
 double OA_(doubleFromULong)(ULong l);
+ULong  OA_(ulongFromDouble)(Double d);
 ULong  OA_(ulongFromTwoInts)(Int a, Int b);
 
 #endif /* ndef __OA_UTILS_H */
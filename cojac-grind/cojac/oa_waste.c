@@ -0,0 +1,293 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.              oa_waste ---*/
+/*--------------------------------------------------------------------*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* Wasted-work profile (--wasted-work=yes).
+ *
+ * Each F64/F32 addition, subtraction, multiplication and division (scalar,
+ * SSE scalar and each packed lane) is counted, with inline IR, in one of
+ * three counters of its site:
+ *
+ * - garbage: an operand is NaN or infinite, so the result is garbage too
+ *   (a simulation that went NaN early keeps computing it);
+ * - no effect: otherwise, an operand is the identity of the operation:
+ *   x+0, 0+x, x-0, x*1, 1*x and x/1. An addition absorbed because of the
+ *   magnitudes (1e20+1) is not counted: it is a precision problem, left
+ *   to Err_Precision, not work that could be skipped;
+ * - useful: all the others (only the total is kept).
+ *
+ * The predicates come from the CmpF64 of the operands; the increments are 0 or 1 and go to memory without a branch.
+ *
+ * At exit the sites are summed per function, the functions are listed by
+ * decreasing wasted work (as a fraction of their FP operations), each with
+ * its sites that wasted anything.
+ */
+
+#include "pub_tool_basics.h"
+#include "pub_tool_tooliface.h"
+#include "pub_tool_libcassert.h"
+#include "pub_tool_libcbase.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_debuginfo.h"
+#include "pub_tool_hashtable.h"
+#include "pub_tool_mallocfree.h"
+#include "oa_include.h"
+
+/*--------------------------------------------------------------------*/
+typedef struct _OA_WasteSite {
+  struct _OA_WasteSite* next;   // VgHashNode layout
+  UWord        key;             // address
+  const HChar* what;
+  ULong        execs;           // lanes computed
+  ULong        noEffect;
+  ULong        garbage;
+  HChar*       fn;              // at exit
+} OA_WasteSite;
+
+static VgHashTable wasteSites = NULL;
+
+void OA_(waste_init)(void) {
+  wasteSites = VG_(HT_construct)("cojac.waste");
+}
+
+static OA_WasteSite* waste_site(OA_InstrumentContext ic) {
+  HChar thisFct[]="waste_site";
+  OA_WasteSite* s = VG_(HT_lookup)(wasteSites, (UWord)ic->addr);
+  if (s == NULL) {
+    s = VG_(calloc)(thisFct, 1, sizeof(OA_WasteSite));
+    s->key  = (UWord)ic->addr;
+    s->what = ic->string[0] != '\0' ? ic->string : "FP";  // op not registered
+    VG_(HT_add_node)(wasteSites, s);
+  }
+  return s;
+}
+
+Bool OA_(waste_watched)(IROp op) {
+  switch(op) {
+    case Iop_AddF64: case Iop_SubF64: case Iop_MulF64: case Iop_DivF64:
+    case Iop_AddF32: case Iop_SubF32: case Iop_MulF32: case Iop_DivF32:
+    case Iop_Add64Fx2: case Iop_Sub64Fx2: case Iop_Mul64Fx2: case Iop_Div64Fx2:
+    case Iop_Add64F0x2: case Iop_Sub64F0x2: case Iop_Mul64F0x2: case Iop_Div64F0x2:
+    case Iop_Add32F0x4: case Iop_Sub32F0x4: case Iop_Mul32F0x4: case Iop_Div32F0x4:
+      return True;
+    default:
+      return False;
+  }
+}
+
+/*--------------------------------------------------------------------*/
+static IRExpr* u32(UInt c) {
+  return IRExpr_Const(IRConst_U32(c));
+}
+
+// 1 if x is NaN or infinite: |x| compares equal or unordered to infinity,
+// the results that have the 0x40 bit (Ircr_EQ, Ircr_UN)
+static IRExpr* notFinite(IRSB* sb, IRExpr* x) {
+  IRExpr* abs = OA_(newTmp)(sb, Ity_F64, IRExpr_Unop(Iop_AbsF64, x));
+  IRExpr* c   = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_CmpF64, abs,
+                                    IRExpr_Const(IRConst_F64i(0x7FF0000000000000ULL))));
+  IRExpr* m   = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32, c, u32(0x40)));
+  return OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Shr32, m, IRExpr_Const(IRConst_U8(6))));
+}
+
+static IRExpr* equal(IRSB* sb, IRExpr* a, IRExpr* b) {
+  IRExpr* c = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_CmpF64, a, b));
+  IRExpr* t = OA_(newTmp)(sb, Ity_I1, IRExpr_Binop(Iop_CmpEQ32, c, u32(Ircr_EQ)));
+  return OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, t));
+}
+
+// *counter += bit (an I32 0/1), and'ed with the scope
+static void add_scoped(IRSB* sb, ULong* counter, IRExpr* bit, IRExpr* scope) {
+  if (scope != NULL) {
+    IRExpr* s = OA_(newTmp)(sb, Ity_I32, IRExpr_Unop(Iop_1Uto32, scope));
+    bit = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32, bit, s));
+  }
+  OA_(add_bit)(sb, counter, bit);
+}
+
+// 0 for an addition or a subtraction, 1 for a multiplication or a division
+static IRExpr* identity(IROp op) {
+  switch(op) {
+    case Iop_MulF64: case Iop_DivF64: case Iop_MulF32: case Iop_DivF32:
+    case Iop_Mul64Fx2: case Iop_Div64Fx2: case Iop_Mul64F0x2: case Iop_Div64F0x2:
+    case Iop_Mul32F0x4: case Iop_Div32F0x4:
+      return IRExpr_Const(IRConst_F64(1.0));
+    default:
+      return IRExpr_Const(IRConst_F64(0.0));
+  }
+}
+
+// x+0 and 0+x, x*1 and 1*x, but only x-0 and x/1
+static Bool commutes(IROp op) {
+  switch(op) {
+    case Iop_AddF64: case Iop_MulF64: case Iop_AddF32: case Iop_MulF32:
+    case Iop_Add64Fx2: case Iop_Mul64Fx2: case Iop_Add64F0x2: case Iop_Mul64F0x2:
+    case Iop_Add32F0x4: case Iop_Mul32F0x4:
+      return True;
+    default:
+      return False;
+  }
+}
+
+static void profile_lane(IRSB* sb, OA_WasteSite* s, IROp op, IRExpr* a,
+                         IRExpr* b) {
+  IRExpr* scope = OA_(scope_guard)(sb);
+  IRExpr* garbage = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Or32,
+                                             notFinite(sb, a), notFinite(sb, b)));
+  IRExpr* same    = equal(sb, b, identity(op));
+  if (commutes(op))
+    same = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Or32, same,
+                                                 equal(sb, a, identity(op))));
+  IRExpr* useless = OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_And32, same,
+                                OA_(newTmp)(sb, Ity_I32, IRExpr_Binop(Iop_Xor32, garbage, u32(1)))));
+  add_scoped(sb, &s->execs, u32(1), scope);
+  add_scoped(sb, &s->garbage, garbage, scope);
+  add_scoped(sb, &s->noEffect, useless, scope);
+}
+
+/* Adds the counters of the (already added) statement st */
+void OA_(waste_profile)(IRSB* sb, IRStmt* st, OA_InstrumentContext ic) {
+  IRExpr* e = st->Ist.WrTmp.data;
+  OA_WasteSite* s = waste_site(ic);
+  switch(ic->op) {
+    case Iop_AddF64: case Iop_SubF64: case Iop_MulF64: case Iop_DivF64:
+      profile_lane(sb, s, ic->op, e->Iex.Triop.details->arg2, e->Iex.Triop.details->arg3);
+      break;
+    case Iop_AddF32: case Iop_SubF32: case Iop_MulF32: case Iop_DivF32:
+      profile_lane(sb, s, ic->op, OA_(toF64)(sb, e->Iex.Triop.details->arg2),
+                   OA_(toF64)(sb, e->Iex.Triop.details->arg3));
+      break;
+    case Iop_Add64Fx2: case Iop_Sub64Fx2: case Iop_Mul64Fx2: case Iop_Div64Fx2:
+      profile_lane(sb, s, ic->op, OA_(laneF64)(sb, e->Iex.Binop.arg1, 1),
+                   OA_(laneF64)(sb, e->Iex.Binop.arg2, 1));
+      // fall through, for the low lane
+    case Iop_Add64F0x2: case Iop_Sub64F0x2: case Iop_Mul64F0x2: case Iop_Div64F0x2:
+      profile_lane(sb, s, ic->op, OA_(laneF64)(sb, e->Iex.Binop.arg1, 0),
+                   OA_(laneF64)(sb, e->Iex.Binop.arg2, 0));
+      break;
+    case Iop_Add32F0x4: case Iop_Sub32F0x4: case Iop_Mul32F0x4: case Iop_Div32F0x4:
+      profile_lane(sb, s, ic->op, OA_(lane0F32)(sb, e->Iex.Binop.arg1),
+                   OA_(lane0F32)(sb, e->Iex.Binop.arg2));
+      break;
+    default:
+      break;
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/*--- Report                                                       ---*/
+/*--------------------------------------------------------------------*/
+
+typedef struct {
+  const HChar* fn;
+  ULong        execs, noEffect, garbage;
+  UInt         first, n;      // its sites, in the sorted array
+} OA_WasteFn;
+
+static Int cmp_site_fn(const void* a, const void* b) {
+  const OA_WasteSite* x = *(const OA_WasteSite* const*)a;
+  const OA_WasteSite* y = *(const OA_WasteSite* const*)b;
+  Int c = VG_(strcmp)(x->fn, y->fn);
+  if (c != 0) return c;
+  if (x->noEffect + x->garbage != y->noEffect + y->garbage)
+    return x->noEffect + x->garbage < y->noEffect + y->garbage ? 1 : -1;
+  return x->key < y->key ? -1 : x->key > y->key ? 1 : 0;
+}
+
+static Int cmp_fn_wasted(const void* a, const void* b) {
+  const OA_WasteFn* x = (const OA_WasteFn*)a;
+  const OA_WasteFn* y = (const OA_WasteFn*)b;
+  ULong wx = x->noEffect + x->garbage, wy = y->noEffect + y->garbage;
+  if (wx != wy) return wx < wy ? 1 : -1;
+  return VG_(strcmp)(x->fn, y->fn);
+}
+
+static void print_site(OA_WasteSite* s) {
+  HChar fn[COJAC_FCT_LEN];
+  HChar file[COJAC_FILE_LEN];
+  UInt  lineNo;
+  OA_(site_location)(s->key, fn, file, &lineNo);
+  VG_(umsg)("    %12llu %s   at %#lx: %s (%s:%u), %llu with no effect, "
+            "%llu on NaN/Inf\n", s->execs, s->what, s->key, fn, file,
+            lineNo, s->noEffect, s->garbage);
+}
+
+void OA_(waste_fini)(void) {
+  HChar thisFct[]="waste_fini";
+  OA_WasteSite** sorted;
+  OA_WasteFn*    fns;
+  UInt  i, j, n, nFns = 0;
+  HChar buf[16];
+  if (wasteSites == NULL) return;
+  sorted = (OA_WasteSite**)VG_(HT_to_array)(wasteSites, &n);
+  for (i = 0; i < n; i++) {
+    HChar fn[COJAC_FCT_LEN];
+    if (!VG_(get_fnname)(sorted[i]->key, fn, sizeof(fn)))
+      VG_(strcpy)(fn, "???");
+    sorted[i]->fn = VG_(strdup)(thisFct, fn);
+  }
+  VG_(ssort)(sorted, n, sizeof(OA_WasteSite*), cmp_site_fn);
+  fns = VG_(malloc)(thisFct, (n + 1) * sizeof(OA_WasteFn));
+  for (i = 0; i < n; i++) {
+    OA_WasteSite* s = sorted[i];
+    if (nFns == 0 || !VG_STREQ(fns[nFns-1].fn, s->fn)) {
+      fns[nFns].fn = s->fn;
+      fns[nFns].execs = fns[nFns].noEffect = fns[nFns].garbage = 0;
+      fns[nFns].first = i;
+      fns[nFns].n = 0;
+      nFns++;
+    }
+    fns[nFns-1].execs    += s->execs;
+    fns[nFns-1].noEffect += s->noEffect;
+    fns[nFns-1].garbage  += s->garbage;
+    fns[nFns-1].n++;
+  }
+  VG_(ssort)(fns, nFns, sizeof(OA_WasteFn), cmp_fn_wasted);
+  VG_(umsg)("Cojac: wasted FP work by function (no effect, or on NaN/Inf)\n");
+  for (i = 0; i < nFns; i++) {
+    OA_WasteFn* f = &fns[i];
+    if (f->execs == 0) continue;
+    VG_(umsg)("  %12llu FP ops in %s: %s wasted, %llu with no effect, "
+              "%llu on NaN/Inf\n", f->execs, f->fn,
+              OA_(percent)(f->noEffect + f->garbage, f->execs, buf),
+              f->noEffect, f->garbage);
+    for (j = f->first; j < f->first + f->n; j++)
+      if (sorted[j]->noEffect + sorted[j]->garbage > 0)
+        print_site(sorted[j]);
+  }
+  for (i = 0; i < n; i++) {
+    VG_(free)(sorted[i]->fn);
+    sorted[i]->fn = NULL;
+  }
+  VG_(free)(fns);
+  VG_(free)(sorted);
+}
+
+/*--------------------------------------------------------------------*/
+/*--- end                                                          ---*/
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,13 @@
+#include <limits.h>
+
+int add(int a, int b){
+	return a + b;
+}
+
+int main (void){
+	int i, r[4];
+	for (i = 0; i < 3; i++)
+		r[i] = add(INT_MAX, 1);
+	r[3] = add(INT_MAX, 2);
+	return 0;
+}
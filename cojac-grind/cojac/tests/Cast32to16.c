@@ -0,0 +1,8 @@
+int main(void) {
+	int a = 70000;
+	short s = 0x100, lo, hi;
+	__asm__ __volatile__ ("vpinsrw $0, %0, %%xmm0, %%xmm0" : : "r" (a) : "xmm0");
+	// the low half of imulw is not a truncation
+	__asm__ ("imulw %3" : "=a" (lo), "=d" (hi) : "a" (s), "r" (s));
+	return lo + hi;
+}
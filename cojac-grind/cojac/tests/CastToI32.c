@@ -0,0 +1,10 @@
+int main(void) {
+	volatile long long l = 0x100000000LL;
+	volatile int i;
+	int a = 0x10000, d = 3, lo, hi;
+	i = l;
+	// the low halves of imul and div are not truncations
+	__asm__ ("imull %3" : "=a" (lo), "=d" (hi) : "a" (a), "r" (a));
+	__asm__ ("divl %4" : "=a" (lo), "=d" (hi) : "a" (7), "d" (0), "r" (d));
+	return lo + hi;
+}
@@ -0,0 +1,5 @@
+int main(void) {
+	int a = 0x1234;
+	__asm__ __volatile__ ("pinsrb $0, %0, %%xmm0" : : "r" (a) : "xmm0");
+	return 0;
+}
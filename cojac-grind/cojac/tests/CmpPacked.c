@@ -0,0 +1,10 @@
+#include <float.h>
+#include <math.h>
+#include <emmintrin.h>
+
+int main(int argc, char **argv){
+  __m128d a = _mm_set_pd(NAN, 1.0);
+  __m128d b = _mm_set_pd(2.0, 1.0 + DBL_EPSILON);
+  __m128d c = _mm_cmplt_pd(a, b);
+  return _mm_movemask_pd(c);
+}
@@ -0,0 +1,12 @@
+volatile float  f = 1.5f, g;
+volatile double d, e = 0.1;
+
+int main (void){
+	int i;
+	for (i = 0; i < 4; i++)
+		d = f;   // widened
+	for (i = 0; i < 3; i++)
+		g = d;   // and narrowed back unchanged
+	g = e;       // rounded
+	return 0;
+}
@@ -0,0 +1,7 @@
+double big = 1.0e308;
+
+int main(int argc, char **argv){
+  double twice = 2.0;
+  double c = big * twice;
+  return 0;
+}
@@ -0,0 +1,16 @@
+#include <limits.h>
+#include "valgrind.h"
+
+int add(int a, int b){
+	return a + b;
+}
+
+int main (void){
+	int i;
+	int c = 0;
+	for (i = 0; i < 3; i++) {
+		c = add(INT_MAX, 1);
+		VALGRIND_DISCARD_TRANSLATIONS((char*)&add, 64);
+	}
+	return c;
+}
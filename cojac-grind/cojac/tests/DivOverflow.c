@@ -0,0 +1,18 @@
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+
+static void on_fpe(int sig) {
+	_exit(0);
+}
+
+int main (void){
+	volatile int a;
+	volatile int b;
+	int c;
+	signal(SIGFPE, on_fpe);
+	a = INT_MIN;
+	b = -1;
+	c = a / b;  // idiv: DivModS64to32
+	return c;
+}
@@ -0,0 +1,11 @@
+#include <stdio.h>
+#include <limits.h>
+#include <float.h>
+
+
+int main(){
+	volatile float a = 3.0e9f;
+	int b;
+	b = a;  // amd64: cvttss2si, checked as F32 widened to F64
+	return 0;
+}
@@ -0,0 +1,8 @@
+int main(void) {
+	double a[4] = { 1.0, 2.0, 3.0, 4.0 };
+	double b[4] = { 1.0, 1.0, 0.0, 1.0 };
+	double c[4];
+	__asm__ __volatile__ ("vmovupd %1, %%ymm0; vdivpd %2, %%ymm0, %%ymm0; vmovupd %%ymm0, %0"
+	                      : "=m" (c) : "m" (a), "m" (b) : "xmm0");
+	return c[0] == 1.0 ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+volatile double scale[2] = {1.0, 1e308};
+volatile double start[2] = {3.0, 1.0000000000000002};
+
+int main (void){
+	volatile double r;
+	int i;
+	for (i = 0; i < 1000000; i++) {
+		r = scale[i >= 500000] * 10.0;  // infinity: still found once hot
+		r = start[i >= 500000] - 1.0;   // cancellation: only in the cold executions
+	}
+	return 0;
+}
@@ -0,0 +1,13 @@
+#include <limits.h>
+
+int main (void){
+	int a = INT_MAX;
+	int b = 1;
+	int c;
+	int i;
+	c = a + b;
+	c = a + 2;
+	for (i = 0; i < 3; i++)
+		c = a + 3;
+	return c;
+}
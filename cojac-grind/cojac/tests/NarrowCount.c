@@ -0,0 +1,17 @@
+#include <math.h>
+
+int main(void) {
+	volatile double big = 3e9;
+	volatile double inf = INFINITY;
+	volatile double nan = NAN;
+	volatile long long l = 0x100000000LL;
+	volatile int i;
+	int a = 0x10000, lo, hi, k;
+	for (k = 0; k < 4; k++) i = l;
+	for (k = 0; k < 3; k++) i = big;
+	for (k = 0; k < 2; k++) i = inf;
+	i = nan;
+	// the low half of imul, 0 here, is not a truncation
+	__asm__ ("imull %3" : "=a" (lo), "=d" (hi) : "a" (a), "r" (a));
+	return lo + hi;
+}
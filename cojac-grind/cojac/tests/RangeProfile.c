@@ -0,0 +1,14 @@
+volatile double r1, r2, r3;
+
+int main (void){
+	double a = 1.5, b = 0.25;
+	double x = 1.0, y = 1e-10;
+	double s = 1e-310;   // subnormal
+	int i;
+	for (i = 0; i < 3; i++)
+		r1 = a * b;  // within the float range and precision
+	r2 = x + y;      // y would be lost in a float
+	for (i = 0; i < 2; i++)
+		r3 = s * 3.0;  // far below the float range
+	return 0;
+}
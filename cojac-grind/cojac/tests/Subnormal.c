@@ -0,0 +1,9 @@
+volatile double a = 1e-310, b = 2.0, c;
+
+int main (void){
+	int i;
+	for (i = 0; i < 5; i++)
+		c = a * b;   // subnormal operand and result
+	c = b * b;
+	return 0;
+}
@@ -0,0 +1,12 @@
+typedef float v4sf __attribute__ ((vector_size (16)));
+
+volatile float x = 1e-40f;   // subnormal
+
+int main (void){
+	v4sf v = { 1.0f, 2.0f, x, 3.0f };
+	v4sf w;
+	int i;
+	for (i = 0; i < 3; i++)
+		__asm__ ("mulps %1, %0" : "=x" (w) : "x" (v), "0" (v));   // in lane 2
+	return w[0] > 0.0f ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+volatile double x = 2.0, y = 4.0, zero = 0.0, one = 1.0, big = 1e20;
+volatile double qnan = __builtin_nan(""), r;
+
+int main (void){
+	int i;
+	for (i = 0; i < 4; i++)
+		r = x + zero;   // no effect
+	for (i = 0; i < 2; i++)
+		r = qnan * x;    // garbage
+	r = x * x;
+	r = y - x;       // equal to the second operand, but useful
+	r = x / one;     // no effect
+	r = big + one;   // absorbed, a precision problem, not an identity
+	return 0;
+}
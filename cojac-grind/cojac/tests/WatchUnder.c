@@ -0,0 +1,20 @@
+#include <limits.h>
+
+int add(int a, int b){
+	return a + b;
+}
+
+int incr(int a){
+	return a + 1;
+}
+
+int solve_step(int a){
+	return add(a, 1);
+}
+
+int main (void){
+	int c;
+	c = incr(INT_MAX);
+	c = solve_step(INT_MAX);
+	return c;
+}
@@ -0,0 +1,333 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.          bench_checks ---*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* Microbenchmark of the check kernels, outside of Valgrind.
+ *
+ * The oa_callbacks_*.c files are linked, as they are, with bench_shim.c,
+ * and their amd64 entry points are called directly on arrays of clean,
+ * borderline (close to a threshold, no error) and pathological operands.
+ *
+ *   bench_checks            ns/check per IROp and operand class, with all
+ *                           the kinds on, then per kind with only that
+ *                           kind on (what a --kinds=<k> run pays)
+ *   bench_checks --check    runs each kernel on known operands and
+ *                           compares the error found with the expected
+ *                           one; exits with 1 on a mismatch
+ *
+ * It is not a Valgrind test: no .vgtest, run it by hand after changing a
+ * kernel (build it with "make check"). */
+
+#include "../oa_include.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <float.h>
+#include <math.h>
+#include <sys/time.h>
+
+extern ULong bench_errors[Err_Subnormal+1];
+extern Int   bench_last_error;
+
+#define N_OPERANDS  4096
+#define N_CHECKS    (1 << 20)   // per measured cell
+
+typedef enum { SH_2xF64, SH_2xF32, SH_2x64, SH_2x32, SH_2x16, SH_F64toInt } Shape;
+typedef enum { CL_CLEAN, CL_BORDER, CL_PATHO, CL_N } OperandClass;
+
+static const char* classNames[CL_N] = { "clean", "borderline", "patho" };
+
+static const char* kindNames[Err_Subnormal+1] = {
+  "overflow", "cast", "cancellation", "nan", "inf", "precision", "math",
+  "divbyzero", "underflow", "comparison", "subnormal"
+};
+
+typedef struct {
+  IROp op;
+  const char* name;
+  Shape shape;
+} BenchOp;
+
+static BenchOp benchOps[] = {
+  { Iop_Add64F0x2, "Add64F0x2", SH_2xF64 },
+  { Iop_Sub64F0x2, "Sub64F0x2", SH_2xF64 },
+  { Iop_Mul64F0x2, "Mul64F0x2", SH_2xF64 },
+  { Iop_Div64F0x2, "Div64F0x2", SH_2xF64 },
+  { Iop_CmpF64,    "CmpF64",    SH_2xF64 },
+  { Iop_AddF32,    "AddF32",    SH_2xF32 },
+  { Iop_SubF32,    "SubF32",    SH_2xF32 },
+  { Iop_MulF32,    "MulF32",    SH_2xF32 },
+  { Iop_DivF32,    "DivF32",    SH_2xF32 },
+  { Iop_CmpF32,    "CmpF32",    SH_2xF32 },
+  { Iop_Add64,     "Add64",     SH_2x64 },
+  { Iop_Sub64,     "Sub64",     SH_2x64 },
+  { Iop_Mul64,     "Mul64",     SH_2x64 },
+  { Iop_Add32,     "Add32",     SH_2x32 },
+  { Iop_Sub32,     "Sub32",     SH_2x32 },
+  { Iop_Mul32,     "Mul32",     SH_2x32 },
+  { Iop_Add16,     "Add16",     SH_2x16 },
+  { Iop_Mul16,     "Mul16",     SH_2x16 },
+  { Iop_F64toI32S, "F64toI32S", SH_F64toInt },
+};
+#define N_OPS ((int)(sizeof(benchOps)/sizeof(benchOps[0])))
+
+/*--------------------------------------------------------------------*/
+/* Operands, passed the way the instrumented code passes them: the F64
+ * bits, the F32 bits in the low half, the integers sign-extended. */
+
+static ULong fromDouble(double d) { ULong u; memcpy(&u, &d, 8); return u; }
+static ULong fromFloat(float f)   { UInt u;  memcpy(&u, &f, 4); return u; }
+
+static ULong opA[N_OPERANDS], opB[N_OPERANDS];
+
+static unsigned int seed = 12345;
+static double uniform(void) {   // in [0,1), reproducible
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 8) / 16777216.0;
+}
+
+static void fp_operands(OperandClass cl, int i, double* a, double* b) {
+  double x = 1.0 + uniform();
+  switch (cl) {
+    case CL_CLEAN:  *a = x; *b = 0.25 + uniform()/8; break;
+    case CL_BORDER: *a = x; *b = x * (1.0 - 64*DBL_EPSILON); break; // 64 ulps apart
+    default:
+      switch (i % 4) {
+        case 0:  *a = x; *b = nextafter(x, 0.0);  break;  // cancellation
+        case 1:  *a = x; *b = x * 1e-20;          break;  // precision
+        case 2:  *a = 1e300*x; *b = 1e300;        break;  // inf (+, *)
+        default: *a = 1e-300; *b = (i%8 == 3) ? 0.0 : 1e-300*x;  // underflow (*), zero (/)
+      }
+  }
+}
+
+static void int_operands(OperandClass cl, IROp op, Long max, Long* a, Long* b) {
+  Long x = (Long)(uniform() * 100);
+  Long root = (Long)sqrt((double)max) - 1;
+  Bool isMul = op == Iop_Mul64 || op == Iop_Mul32 || op == Iop_Mul16;
+  Bool isSub = op == Iop_Sub64 || op == Iop_Sub32;
+  switch (cl) {
+    case CL_CLEAN:  *a = x; *b = x/3 + 1; break;
+    case CL_BORDER:     // just fits
+      *a = isMul ? root : max/2;
+      *b = isMul ? root - x : max/2 - x;
+      break;
+    default:            // overflows
+      *a = isMul ? 2*root + x : max - x;    // Mul32/Mul64 are unsigned
+      *b = isMul ? *a : x + 1;
+      break;
+  }
+  if (isSub && cl != CL_CLEAN) *b = -*b - (cl == CL_PATHO);
+}
+
+static void make_operands(BenchOp* bop, OperandClass cl) {
+  Shape sh = bop->shape;
+  int i;
+  double a, b;
+  Long la, lb;
+  for (i = 0; i < N_OPERANDS; i++) {
+    switch (sh) {
+      case SH_2xF64:
+        fp_operands(cl, i, &a, &b);
+        opA[i] = fromDouble(a); opB[i] = fromDouble(b);
+        break;
+      case SH_2xF32:
+        fp_operands(cl, i, &a, &b);
+        if (cl == CL_BORDER) b = a * (1.0 - 64*FLT_EPSILON);
+        if (cl == CL_PATHO && i%4 == 0) b = nextafterf((float)a, 0.0f);
+        if (cl == CL_PATHO && i%4 >= 2) { a = (i%4 == 2) ? 1e30*a : 1e-30; b = a; }
+        opA[i] = fromFloat((float)a); opB[i] = fromFloat((float)b);
+        break;
+      case SH_F64toInt:
+        a = uniform() * 1000;
+        if (cl == CL_BORDER) a = INT_MAX - a;
+        if (cl == CL_PATHO)  a = (i%2) ? 1e12 : -1e12;
+        opA[i] = fromDouble(a); opB[i] = 0;
+        break;
+      default:
+        int_operands(cl, bop->op, sh == SH_2x64 ? LLONG_MAX : sh == SH_2x32 ? INT_MAX : SHRT_MAX,
+                     &la, &lb);
+        opA[i] = (ULong)la; opB[i] = (ULong)lb;
+        break;
+    }
+  }
+}
+
+/*--------------------------------------------------------------------*/
+
+static void run_one(Shape sh, ULong a, ULong b, OA_InstrumentContext ic) {
+  switch (sh) {
+    case SH_2xF64:    oa_callbackI64_2xF64(a, b, ic); break;
+    case SH_2xF32:    oa_callbackI64_2xF32(a, b, ic); break;
+    case SH_2x64:     oa_callbackI64_2x64((Long)a, (Long)b, ic); break;
+    case SH_2x32:     oa_callbackI64_2x32(a, b, ic); break;
+    case SH_2x16:     oa_callbackI64_2x16(a, b, ic); break;
+    case SH_F64toInt: oa_callbackI64_1xI32_1xF64(0, a, ic); break;
+  }
+}
+
+static double now_ns(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e9 + tv.tv_usec * 1e3;
+}
+
+// Mean ns per call of the kernel of op, on the current operands
+static double measure(BenchOp* bop) {
+  OA_InstrumentContext_ ic;
+  double start;
+  int i, n;
+  memset(&ic, 0, sizeof(ic));
+  ic.op = bop->op;
+  ic.string = (HChar*)bop->name;
+  start = now_ns();
+  for (n = 0; n < N_CHECKS; n += N_OPERANDS)
+    for (i = 0; i < N_OPERANDS; i++)
+      run_one(bop->shape, opA[i], opB[i], &ic);
+  return (now_ns() - start) / N_CHECKS;
+}
+
+static void bench(void) {
+  double perKind[Err_Subnormal+1];
+  int k, o, cl;
+  printf("%-10s %-10s %10s  %s\n", "op", "operands", "ns/check", "errors per 1000 checks");
+  for (o = 0; o < N_OPS; o++) {
+    for (cl = 0; cl < CL_N; cl++) {
+      make_operands(&benchOps[o], cl);
+      memset(bench_errors, 0, sizeof(bench_errors));
+      OA_(options).kinds = OA_ALL_KINDS;
+      printf("%-10s %-10s %10.2f ", benchOps[o].name, classNames[cl], measure(&benchOps[o]));
+      for (k = 0; k <= Err_Subnormal; k++)
+        if (bench_errors[k] > 0)
+          printf(" %s=%.0f", kindNames[k], bench_errors[k] * 1000.0 / N_CHECKS);
+      printf("\n");
+    }
+  }
+
+  // Each kind alone, averaged over the ops and operand classes
+  printf("\n%-12s %10s\n", "kinds=", "ns/check");
+  for (k = 0; k <= Err_CloseComparison; k++) {
+    perKind[k] = 0.0;
+    for (o = 0; o < N_OPS; o++) {
+      for (cl = 0; cl < CL_N; cl++) {
+        make_operands(&benchOps[o], cl);
+        OA_(options).kinds = OA_KIND_BIT(k);
+        perKind[k] += measure(&benchOps[o]);
+      }
+    }
+    printf("%-12s %10.2f\n", kindNames[k], perKind[k] / (N_OPS*CL_N));
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/* Correctness: one kernel call per case, all the kinds on */
+
+typedef struct {
+  IROp op;
+  Shape shape;
+  double a, b;      // the operands, for the FP shapes
+  Long ia, ib;      // the operands, for the integer shapes
+  Int expected;     // ErrorKind, or OA_NoError
+} CheckCase;
+
+#define FP(op,sh,a,b,e)   { op, sh, a, b, 0, 0, e }
+#define INT(op,sh,a,b,e)  { op, sh, 0, 0, a, b, e }
+
+static CheckCase checkCases[] = {
+  FP(Iop_Add64F0x2, SH_2xF64, 1.0, 0.5,        OA_NoError),
+  FP(Iop_Add64F0x2, SH_2xF64, 1.0, 1e-20,      Err_Precision),
+  FP(Iop_Add64F0x2, SH_2xF64, 1e308, 1e308,    Err_Infinity),
+  FP(Iop_Sub64F0x2, SH_2xF64, 1.0, 0.25,       OA_NoError),
+  FP(Iop_Sub64F0x2, SH_2xF64, 1.0, 1.0 - DBL_EPSILON/2, Err_Cancellation),
+  FP(Iop_Sub64F0x2, SH_2xF64, INFINITY, INFINITY, Err_NaN),
+  FP(Iop_Mul64F0x2, SH_2xF64, 1e200, 1e200,    Err_Infinity),
+  FP(Iop_Mul64F0x2, SH_2xF64, 1e-200, 1e-200,  Err_Underflow),
+  FP(Iop_Div64F0x2, SH_2xF64, 1.0, 3.0,        OA_NoError),
+  FP(Iop_Div64F0x2, SH_2xF64, 1.0, 0.0,        Err_DivByZero),
+  FP(Iop_CmpF64,    SH_2xF64, 1.0, 1.0 + DBL_EPSILON, Err_CloseComparison),
+  FP(Iop_CmpF64,    SH_2xF64, 1.0, 1.5,        OA_NoError),
+  FP(Iop_CmpF64,    SH_2xF64, NAN, 1.0,        Err_NaN),
+  FP(Iop_AddF32,    SH_2xF32, 1.0, 1e-10,      Err_Precision),
+  FP(Iop_SubF32,    SH_2xF32, 1.0, 1.0 - FLT_EPSILON/2, Err_Cancellation),
+  FP(Iop_MulF32,    SH_2xF32, 1e30, 1e30,      Err_Infinity),
+  FP(Iop_DivF32,    SH_2xF32, 1.0, 4.0,        OA_NoError),
+  FP(Iop_F64toI32S, SH_F64toInt, 3e9, 0,       Err_Overflow),
+  FP(Iop_F64toI32S, SH_F64toInt, 2e9, 0,       OA_NoError),
+  INT(Iop_Add64,    SH_2x64, LLONG_MAX, 1,     Err_Overflow),
+  INT(Iop_Sub64,    SH_2x64, LLONG_MIN, 1,     Err_Overflow),
+  INT(Iop_Add64,    SH_2x64, 1, 2,             OA_NoError),
+  INT(Iop_Add32,    SH_2x32, INT_MAX, 1,       Err_Overflow),
+  INT(Iop_Add32,    SH_2x32, INT_MIN, -1,      Err_Overflow),
+  INT(Iop_Add32,    SH_2x32, INT_MAX/2, INT_MAX/2, OA_NoError),
+  INT(Iop_Mul32,    SH_2x32, 65536, 65536,     Err_Overflow),
+  INT(Iop_Add16,    SH_2x16, SHRT_MAX, 1,      Err_Overflow),
+  INT(Iop_Add16,    SH_2x16, 100, 200,         OA_NoError),
+};
+#define N_CASES ((int)(sizeof(checkCases)/sizeof(checkCases[0])))
+
+static int check(void) {
+  OA_InstrumentContext_ ic;
+  int i, failed = 0;
+  memset(&ic, 0, sizeof(ic));
+  OA_(options).kinds = OA_ALL_KINDS;
+  for (i = 0; i < N_CASES; i++) {
+    CheckCase* c = &checkCases[i];
+    ULong a, b;
+    if (c->shape == SH_2xF32) {
+      a = fromFloat((float)c->a); b = fromFloat((float)c->b);
+    } else if (c->shape == SH_2xF64 || c->shape == SH_F64toInt) {
+      a = fromDouble(c->a); b = fromDouble(c->b);
+    } else {
+      a = (ULong)c->ia; b = (ULong)c->ib;
+    }
+    ic.op = c->op;
+    bench_last_error = OA_NoError;
+    run_one(c->shape, a, b, &ic);
+    if (bench_last_error != c->expected) {
+      printf("case %d (op 0x%x): found %s, expected %s\n", i, (unsigned)c->op,
+             bench_last_error == OA_NoError ? "none" : kindNames[bench_last_error],
+             c->expected == OA_NoError ? "none" : kindNames[c->expected]);
+      failed++;
+    }
+  }
+  printf("bench_checks: %d cases, %d failed\n", N_CASES, failed);
+  return failed > 0;
+}
+
+int main(int argc, char** argv) {
+  // as oa_set_default_options()
+  OA_(options).Ulp_factor_f64 = 4.0;
+  OA_(options).Ulp_factor_f32 = 4.0;
+  OA_(options).f32 = OA_(options).f64 = True;
+  OA_(options).i16 = OA_(options).i32 = OA_(options).i64 = True;
+  OA_(options).kinds = OA_ALL_KINDS;
+  if (argc > 1 && strcmp(argv[1], "--check") == 0)
+    return check();
+  bench();
+  return 0;
+}
@@ -0,0 +1,62 @@
+/*--------------------------------------------------------------------*/
+/*--- Cojac-grind numerical problem sniffer.            bench_shim ---*/
+
+/*
+   This file is part of Cojac-grind, which watches arithmetic operations to
+   detect overflows, cancellation, smearing, and other suspicious phenomena.
+
+   Copyright (C) 2011-2014 Frederic Bapst & Luis Domingues
+      frederic.bapst@gmail.com, domigues.luis@gmail.com
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+   02111-1307, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+ */
+
+/* The few core and tool symbols the check kernels (oa_callbacks_*.c) need,
+ * so that they can be linked into a normal program: see bench_checks.c.
+ * OA_(maybe_error) only counts the errors per kind, and remembers the
+ * last one for the correctness checks. */
+
+#include "../oa_include.h"
+#include "pub_tool_basics.h"
+#include "pub_tool_libcprint.h"
+#include "pub_tool_threadstate.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+cojacOptions OA_(options);
+
+ULong bench_errors[Err_Subnormal+1];
+Int   bench_last_error = OA_NoError;
+
+void OA_(maybe_error)(ErrorKind ekind, OA_InstrumentContext inscon) {
+  bench_errors[ekind]++;
+  bench_last_error = ekind;
+}
+
+ThreadId VG_(get_running_tid)(void) {
+  return 1;
+}
+
+UInt VG_(printf)(const HChar *format, ...) {
+  va_list vargs;
+  int n;
+  va_start(vargs, format);
+  n = vprintf(format, vargs);
+  va_end(vargs);
+  return n;
+}
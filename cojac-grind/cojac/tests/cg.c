@@ -0,0 +1,71 @@
+// Conjugate gradient on a sparse matrix: the 5-point Laplacian of a square
+// grid, in compressed sparse row (CSR) format.  Dominated by the sparse
+// matrix-vector product (indirect loads, F64 multiply-adds) and by the dot
+// products and vector updates of the iteration.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define GRID   200
+#define N      (GRID*GRID)
+#define ITERS  1000
+
+static int    rowStart[N+1], col[5*N];
+static double val[5*N];
+static double x[N], b[N], r[N], p[N], q[N];
+
+static void build(void)
+{
+   int i, j, nz = 0;
+   for (i = 0; i < GRID; i++)
+      for (j = 0; j < GRID; j++) {
+         int row = i*GRID + j;
+         rowStart[row] = nz;
+         if (i > 0)      { col[nz] = row-GRID; val[nz++] = -1.0; }
+         if (j > 0)      { col[nz] = row-1;    val[nz++] = -1.0; }
+         col[nz] = row; val[nz++] = 4.0;
+         if (j < GRID-1) { col[nz] = row+1;    val[nz++] = -1.0; }
+         if (i < GRID-1) { col[nz] = row+GRID; val[nz++] = -1.0; }
+         b[row] = 1.0;
+      }
+   rowStart[N] = nz;
+}
+
+static void spmv(const double* v, double* res)
+{
+   int i, k;
+   for (i = 0; i < N; i++) {
+      double s = 0;
+      for (k = rowStart[i]; k < rowStart[i+1]; k++)
+         s += val[k] * v[col[k]];
+      res[i] = s;
+   }
+}
+
+static double dot(const double* u, const double* v)
+{
+   int i;
+   double s = 0;
+   for (i = 0; i < N; i++) s += u[i] * v[i];
+   return s;
+}
+
+int main(void)
+{
+   int i, it;
+   double rr, rrNew, alpha;
+   build();
+   for (i = 0; i < N; i++) { x[i] = 0; r[i] = b[i]; p[i] = b[i]; }
+   rr = dot(r, r);
+   for (it = 0; it < ITERS && rr > 1e-20; it++) {
+      spmv(p, q);
+      alpha = rr / dot(p, q);
+      for (i = 0; i < N; i++) { x[i] += alpha * p[i]; r[i] -= alpha * q[i]; }
+      rrNew = dot(r, r);
+      for (i = 0; i < N; i++) p[i] = r[i] + (rrNew / rr) * p[i];
+      rr = rrNew;
+   }
+   printf("cg: %d iterations, residual %.3e\n", it, sqrt(rr));
+   return 0;
+}
@@ -0,0 +1,45 @@
+// The prerequisite of saxpy.vgperf: exits with 0 if the machine, and the
+// OS, support AVX2 (the stock tests/x86_amd64_features only knows AVX),
+// with 1 otherwise.
+
+#if defined(VGA_amd64)
+static void cpuid ( unsigned int n, unsigned int m,
+                    unsigned int* a, unsigned int* b,
+                    unsigned int* c, unsigned int* d )
+{
+   __asm__ __volatile__ (
+      "cpuid"
+      : "=a" (*a), "=b" (*b), "=c" (*c), "=d" (*d)
+      : "0" (n), "2" (m)
+   );
+}
+
+static int os_saves_ymm ( void )
+{
+   unsigned long long int w;
+   __asm__ __volatile__("movq $0,%%rcx ; "
+                        ".byte 0x0F,0x01,0xD0 ; " /* xgetbv */
+                        "movq %%rax,%0"
+                        :/*OUT*/"=r"(w) :/*IN*/
+                        :/*TRASH*/"rdx","rcx");
+   return (w & 6) == 6;
+}
+
+int main ( void )
+{
+   unsigned int a, b, c, d;
+   cpuid(0, 0, &a, &b, &c, &d);
+   if (a < 7) return 1;
+   cpuid(1, 0, &a, &b, &c, &d);
+   if ((c & (1 << 27)) == 0) return 1;   // OSXSAVE: xgetbv is there
+   if (!os_saves_ymm()) return 1;
+   cpuid(7, 0, &a, &b, &c, &d);
+   return (b & (1 << 5)) ? 0 : 1;
+}
+
+#else
+int main ( void )
+{
+   return 1;
+}
+#endif
@@ -0,0 +1,57 @@
+// An open-addressing hash table of integers (linear probing, multiplicative
+// hashing), filled, looked up and emptied repeatedly.  Integer-only code:
+// 32-bit multiplies, shifts and compares, and data-dependent branches.
+
+#include <stdio.h>
+
+#define LOG_SIZE  16
+#define SIZE      (1 << LOG_SIZE)
+#define NKEYS     (SIZE / 2)
+#define REPS      200
+#define EMPTY     0u
+
+static unsigned int table[SIZE];
+
+static unsigned int hash(unsigned int k)
+{
+   return (k * 2654435761u) >> (32 - LOG_SIZE);
+}
+
+static void insert(unsigned int k)
+{
+   unsigned int h = hash(k);
+   while (table[h] != EMPTY && table[h] != k)
+      h = (h + 1) & (SIZE - 1);
+   table[h] = k;
+}
+
+static int lookup(unsigned int k)
+{
+   unsigned int h = hash(k);
+   while (table[h] != EMPTY) {
+      if (table[h] == k) return 1;
+      h = (h + 1) & (SIZE - 1);
+   }
+   return 0;
+}
+
+int main(void)
+{
+   int r, i, found = 0;
+   unsigned int seed;
+   for (r = 0; r < REPS; r++) {
+      for (i = 0; i < SIZE; i++) table[i] = EMPTY;
+      seed = 1 + r;
+      for (i = 0; i < NKEYS; i++) {
+         seed = seed * 1664525u + 1013904223u;
+         insert(seed | 1);
+      }
+      seed = 1 + r;
+      for (i = 0; i < 2 * NKEYS; i++) {
+         seed = seed * 1664525u + 1013904223u;
+         found += lookup(seed | 1);
+      }
+   }
+   printf("inthash: %d found\n", found);
+   return 0;
+}
@@ -0,0 +1,76 @@
+// Dense LU factorisation with partial pivoting, then a solve, repeated.
+// The inner loop is the rank-1 update a[i][j] -= l * a[k][j]: a long run
+// of F64 multiply-subtracts, as in most linear algebra codes.  The matrix
+// is diagonally dominant, so the results stay well conditioned.
+
+#include <stdio.h>
+#include <math.h>
+
+#define N     200
+#define REPS  60
+
+static double a[N][N], b[N], x[N];
+static int    piv[N];
+
+static void init(void)
+{
+   int i, j;
+   unsigned int seed = 12345;
+   for (i = 0; i < N; i++) {
+      for (j = 0; j < N; j++) {
+         seed = seed * 1103515245u + 12345u;
+         a[i][j] = (double)(seed >> 16) / 65536.0 - 0.5;
+      }
+      a[i][i] += N;
+      b[i] = i % 7;
+   }
+}
+
+static void factorise(void)
+{
+   int i, j, k;
+   for (k = 0; k < N; k++) {
+      int p = k;
+      for (i = k+1; i < N; i++)
+         if (fabs(a[i][k]) > fabs(a[p][k])) p = i;
+      piv[k] = p;
+      if (p != k)
+         for (j = 0; j < N; j++) {
+            double t = a[k][j]; a[k][j] = a[p][j]; a[p][j] = t;
+         }
+      for (i = k+1; i < N; i++) {
+         double l = a[i][k] / a[k][k];
+         a[i][k] = l;
+         for (j = k+1; j < N; j++)
+            a[i][j] -= l * a[k][j];
+      }
+   }
+}
+
+static void solve(void)
+{
+   int i, j;
+   for (i = 0; i < N; i++) x[i] = b[i];
+   for (i = 0; i < N; i++) {
+      double t = x[piv[i]]; x[piv[i]] = x[i]; x[i] = t;
+      for (j = i+1; j < N; j++) x[j] -= a[j][i] * x[i];
+   }
+   for (i = N-1; i >= 0; i--) {
+      for (j = i+1; j < N; j++) x[i] -= a[i][j] * x[j];
+      x[i] /= a[i][i];
+   }
+}
+
+int main(void)
+{
+   int r, i;
+   double sum = 0;
+   for (r = 0; r < REPS; r++) {
+      init();
+      factorise();
+      solve();
+   }
+   for (i = 0; i < N; i++) sum += x[i];
+   printf("lu: sum = %.6f\n", sum);
+   return 0;
+}
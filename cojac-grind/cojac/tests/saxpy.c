@@ -0,0 +1,31 @@
+// SAXPY (y = a*x + y, in float) on arrays that fit in the L2 cache,
+// compiled at -O3 -mavx2 so that the loop is auto-vectorised with 256-bit
+// AVX instructions.  Measures the cost of code that a tool does not (or
+// only partly) instrument, in a very tight loop.
+
+#include <stdio.h>
+
+#define N     (16*1024)
+#define REPS  100000
+
+static float x[N], y[N];
+
+__attribute__((noinline))
+static void saxpy(int n, float a, const float* restrict xs, float* restrict ys)
+{
+   int i;
+   for (i = 0; i < n; i++)
+      ys[i] = a * xs[i] + ys[i];
+}
+
+int main(void)
+{
+   int i, r;
+   float sum = 0;
+   for (i = 0; i < N; i++) { x[i] = (float)(i % 100) / 100.0f; y[i] = 0; }
+   for (r = 0; r < REPS; r++)
+      saxpy(N, 1e-4f, x, y);
+   for (i = 0; i < N; i++) sum += y[i];
+   printf("saxpy: sum = %.3f\n", sum);
+   return 0;
+}